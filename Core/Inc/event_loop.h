@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * @file    event_loop.h
+ * @brief   Run-to-completion event loop with an interrupt-fed queue and
+ *          software timers
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __EVENT_LOOP_H
+#define __EVENT_LOOP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ring_buffer.h"
+
+/* Pending events (power of two) and software timers */
+#define EVENT_QUEUE_SIZE        32U
+#define EVENT_MAX_TIMERS        8U
+
+/* Tickless idle: SysTick is stopped only if the next timer is at least
+ * EVENT_TICKLESS_MIN_MS away; one sleep lasts at most EVENT_TICKLESS_MAX_MS */
+#define EVENT_TICK_US           1000U
+#define EVENT_TICKLESS_MIN_MS   2U
+#define EVENT_TICKLESS_MAX_MS   60000U
+
+/* EventTimer_NextDue() with no timer armed */
+#define EVENT_NO_TIMER          0xFFFFFFFFU
+
+/* Event identifiers */
+typedef enum {
+    EVENT_NONE = 0,
+    EVENT_RANGE_DONE,           // HC-SR04 sample completed, arg = sensor id
+    EVENT_FRAME_DONE,           // DCMI frame end or capture error
+    EVENT_TX_DONE,              // Image transfer over UART DMA finished
+    EVENT_SCAN_ARRIVED,         // Timer: gimbal predicted at rest
+    EVENT_CAPTURE_TIMEOUT,      // Timer: frame did not end in time
+    EVENT_SWEEP_ARRIVED,        // Timer: sweep start or end reached
+    EVENT_COUNT
+} EventId_t;
+
+/* One queued event */
+typedef struct {
+    uint16_t id;                // EventId_t
+    uint16_t arg;               // Event specific
+} Event_t;
+
+/* Handler, called from the main loop with the event that fired it */
+typedef void (*Event_Handler_t)(const Event_t *event);
+
+/* Software timer on the HAL millisecond tick */
+typedef struct {
+    uint32_t due;               // HAL tick of the next expiry
+    uint32_t period;            // Reload in ms, 0 = one-shot
+    uint16_t id;                // Event posted on expiry
+    bool active;
+} EventTimer_t;
+
+/* Function prototypes */
+void Event_Init(void);
+void Event_Subscribe(EventId_t id, Event_Handler_t handler);
+void Event_Post(EventId_t id, uint16_t arg);
+void Event_StartTimer(EventId_t id, uint32_t delay_ms, uint32_t period_ms);
+void Event_StopTimer(EventId_t id);
+void Event_Dispatch(void);
+void Event_Idle(bool tickless);
+uint32_t Event_GetDropped(void);
+
+/* Pure calculation functions for unit testing */
+bool EventTimer_Arm(EventTimer_t *timers, uint32_t count, uint16_t id,
+                    uint32_t now, uint32_t delay_ms, uint32_t period_ms);
+void EventTimer_Disarm(EventTimer_t *timers, uint32_t count, uint16_t id);
+uint32_t EventTimer_Expire(EventTimer_t *timers, uint32_t count, uint32_t now, Ring_t *queue);
+uint32_t EventTimer_NextDue(const EventTimer_t *timers, uint32_t count, uint32_t now);
+uint32_t EventTimer_MissedTicks(uint32_t toTick_us, uint32_t slept_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENT_LOOP_H */
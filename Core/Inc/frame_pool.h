@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ * @file    frame_pool.h
+ * @brief   Pool of DMA-capable JPEG frame buffers with ownership states
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __FRAME_POOL_H
+#define __FRAME_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Pool configuration */
+#define FRAME_POOL_SMALL_COUNT  3              // Buffers for QQVGA/QVGA frames
+#define FRAME_BUFFER_SIZE       (10 * 1024)    // 10KB per small JPEG frame
+#define FRAME_POOL_LARGE_COUNT  1              // Buffers for CIF/SVGA frames
+#define FRAME_LARGE_BUFFER_SIZE (48 * 1024)    // 48KB per large JPEG frame
+#define FRAME_POOL_COUNT        (FRAME_POOL_SMALL_COUNT + FRAME_POOL_LARGE_COUNT)
+
+/* Buffer ownership states */
+typedef enum {
+    FRAME_FREE = 0,         // Available for capture
+    FRAME_CAPTURING,        // Owned by DCMI DMA
+    FRAME_READY,            // Holds a complete frame, waiting for transmit
+    FRAME_TRANSMITTING      // Owned by UART DMA
+} FrameState_t;
+
+/* Frame buffer descriptor */
+typedef struct {
+    uint8_t *data;                  // Buffer start (32-bit aligned, main SRAM)
+    uint32_t size;                  // Buffer capacity in bytes
+    uint32_t length;                // Valid JPEG bytes (READY/TRANSMITTING)
+    uint32_t sequence;              // Capture sequence number
+    uint32_t timestamp_us;          // Timebase at frame start (VSYNC)
+    uint8_t truncated;              // Frame did not fit into the buffer
+    volatile FrameState_t state;
+} Frame_t;
+
+/* Function prototypes */
+void FramePool_Init(void);
+Frame_t *FramePool_Acquire(uint32_t minSize);
+void FramePool_MarkReady(Frame_t *frame, uint32_t length, uint8_t truncated);
+Frame_t *FramePool_NextReady(void);
+void FramePool_MarkTransmitting(Frame_t *frame);
+void FramePool_Release(Frame_t *frame);
+uint32_t FramePool_Count(FrameState_t state);
+bool FramePool_HasFree(uint32_t minSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAME_POOL_H */
@@ -1,7 +1,8 @@
 /**
  ******************************************************************************
  * @file    hcsr04.h
- * @brief   HC-SR04 ultrasonic sensor driver using TIM3 Input Capture (Non-blocking)
+ * @brief   HC-SR04 ultrasonic sensor array driver using timer one-pulse
+ *          triggers and input capture (Non-blocking)
  * @author  Generated for STM32F407 Project
  ******************************************************************************
  */
@@ -14,10 +15,39 @@ extern "C" {
 #endif
 
 #include "stm32f4xx_hal.h"
+#include <stdbool.h>
 
-/* HC-SR04 GPIO Pin Definitions */
-#define HCSR04_TRIG_PORT   GPIOB
-#define HCSR04_TRIG_PIN    GPIO_PIN_0
+/* Number of sensor instances the driver can manage */
+#define HCSR04_MAX_SENSORS      4U
+
+/* Echo window measured from the trigger, ~4 m round trip plus margin */
+#define HCSR04_ECHO_WINDOW_US   25000U
+
+/* Scheduler slot length, covers the sensor's ~60 ms echo dead time so a
+ * ping cannot be heard by an overlapping sensor fired in the next slot */
+#define HCSR04_CYCLE_US         60000U
+
+/* Echo edges recorded per trigger by DMA, i.e. up to 4 echoes */
+#define HCSR04_MAX_EDGES        8U
+#define HCSR04_MAX_ECHOES       (HCSR04_MAX_EDGES / 2U)
+
+/* Shorter pulses are glitches, not echoes (~17 mm of range) */
+#define HCSR04_MIN_ECHO_US      100U
+
+/* Air temperature assumed until HCSR04_SetTemperature() is called, 0.1 degC */
+#define HCSR04_DEFAULT_TEMP_DC  200
+
+/* Raw sample ring (power of two) and filter settings */
+#define HCSR04_RING_SIZE        16U
+#define HCSR04_MEDIAN_LEN       5U
+#define HCSR04_EMA_SHIFT        2U      // EMA weight 1/4 per new median
+#define HCSR04_MAX_MISSES       3U      // Consecutive timeouts that drop the estimate
+
+/* Driver status */
+typedef enum {
+    HCSR04_OK = 0,
+    HCSR04_ERROR
+} HCSR04_Result_t;
 
 /* Measurement status */
 typedef enum {
@@ -27,17 +57,84 @@ typedef enum {
     HCSR04_TIMEOUT
 } HCSR04_Status_t;
 
+/* Completion listener, called from interrupt context */
+typedef void (*HCSR04_Callback_t)(uint8_t id, HCSR04_Status_t status);
+
+/* Wiring of one sensor.
+ * TRIG: a timer channel in one-pulse PWM2 mode (counter stopped, CEN fires).
+ * ECHO: one channel of a 1 MHz timer capturing both edges (TIM2..TIM5),
+ *       with a DMA stream linked to the channel's CC request
+ *       (hdma[TIM_DMA_ID_CCx]). Several sensors may share an echo timer.
+ *       The echo timer must be started by TIM2 TRGO (slave trigger mode)
+ *       so its counter matches the low half of the timebase.
+ */
+typedef struct {
+    TIM_HandleTypeDef *trigTim;     // One-pulse timer driving TRIG
+    uint32_t trigChannel;           // TIM_CHANNEL_x of the pulse output
+    bool     trigComplementary;     // Pulse is on CHxN
+    TIM_HandleTypeDef *echoTim;     // 1 MHz capture timer
+    uint32_t echoChannel;           // Both edges, DMA, no interrupt
+    uint8_t  overlap;               // Bitmask of sensors whose beams overlap this one
+} HCSR04_Config_t;
+
+/* Raw measurement as pushed into the sample ring */
+typedef struct {
+    uint32_t timestamp_us;  // Timebase at echo start (window end on timeout)
+    uint16_t echo_us;       // Echo width, 0 on timeout
+    bool     valid;         // false on timeout
+    uint16_t distance_mm;   // Temperature-compensated range, 0 on timeout
+} HCSR04_Sample_t;
+
+/* One pulse of the edge train recorded after a trigger */
+typedef struct {
+    uint32_t start_us;      // Timebase of the rising edge
+    uint16_t width_us;      // Pulse width
+} HCSR04_Echo_t;
+
+/* Median-of-N followed by an exponential moving average */
+typedef struct {
+    uint16_t window[HCSR04_MEDIAN_LEN];
+    uint8_t  count;         // Valid entries in window
+    uint8_t  next;          // Slot for the next echo
+    uint8_t  misses;        // Consecutive timeouts
+    bool     valid;         // Estimate available
+    uint32_t ema_q4;        // Filtered echo width in 1/16 us
+} HCSR04_Filter_t;
+
 /* Function prototypes */
-void HCSR04_Init(void);
-void HCSR04_Trigger(void);
-float HCSR04_GetDistance(void);
-HCSR04_Status_t HCSR04_GetStatus(void);
+HCSR04_Result_t HCSR04_Init(const HCSR04_Config_t *configs, uint8_t count);
+uint8_t HCSR04_GetCount(void);
+void HCSR04_Trigger(uint8_t id);
+float HCSR04_GetDistance(uint8_t id);
+uint16_t HCSR04_GetDistanceMm(uint8_t id);
+HCSR04_Status_t HCSR04_GetStatus(uint8_t id);
+uint8_t HCSR04_GetEchoes(uint8_t id, HCSR04_Echo_t *echoes, uint8_t max);
+void HCSR04_SetCallback(HCSR04_Callback_t callback);
+void HCSR04_SetTemperature(int16_t temp_dC);
+
+/* Continuous ranging through the crosstalk-aware slot scheduler */
+void HCSR04_StartContinuous(void);
+void HCSR04_StopContinuous(void);
+uint8_t HCSR04_GetSlotCount(void);
+bool HCSR04_ReadSample(uint8_t id, HCSR04_Sample_t *sample);
+uint32_t HCSR04_GetDroppedSamples(uint8_t id);
+bool HCSR04_GetFilteredDistance(uint8_t id, float *distance_cm);
+bool HCSR04_GetFilteredDistanceMm(uint8_t id, uint16_t *distance_mm);
+void HCSR04_ResetFilter(uint8_t id);
 
 /* Interrupt callback (to be called from stm32f4xx_it.c) */
-void HCSR04_CaptureCallback(void);
+void HCSR04_CompareCallback(TIM_HandleTypeDef *htim);
 
-/* Pure calculation function for unit testing */
+/* Pure calculation functions for unit testing */
 float HCSR04_PulseToDistance(uint32_t pulseWidth_us);
+uint32_t HCSR04_SoundFactorQ16(int16_t temp_dC);
+uint32_t HCSR04_PulseToMillimetres(uint32_t echo_us, uint32_t factor_q16);
+uint8_t HCSR04_ExtractEchoes(const uint16_t *edges, uint8_t count, uint32_t now,
+                             HCSR04_Echo_t *echoes);
+uint16_t HCSR04_Median(const uint16_t *values, uint8_t count);
+void HCSR04_FilterReset(HCSR04_Filter_t *filter);
+bool HCSR04_FilterUpdate(HCSR04_Filter_t *filter, const HCSR04_Sample_t *sample);
+uint8_t HCSR04_BuildSchedule(const uint8_t *overlap, uint8_t count, uint8_t *slots);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,29 @@
+/**
+ ******************************************************************************
+ * @file    mem_barrier.h
+ * @brief   Data memory barrier for code shared by the firmware and host tests
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __MEM_BARRIER_H
+#define __MEM_BARRIER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Complete earlier memory accesses before later ones: DMB on the Cortex-M4,
+ * a full compiler and CPU barrier on the host */
+#if defined(__arm__)
+#include "cmsis_compiler.h"
+#define MEM_BARRIER()           __DMB()
+#else
+#define MEM_BARRIER()           __sync_synchronize()
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MEM_BARRIER_H */
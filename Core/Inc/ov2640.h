@@ -14,6 +14,7 @@ extern "C" {
 #endif
 
 #include "stm32f4xx_hal.h"
+#include <stdbool.h>
 
 /* OV2640 Control Pins */
 #define OV2640_RESET_PORT   GPIOC
@@ -22,30 +23,109 @@ extern "C" {
 #define OV2640_PWDN_PORT    GPIOC
 #define OV2640_PWDN_PIN     GPIO_PIN_12
 
+/* OV2640 Register Structure */
+typedef struct {
+    uint8_t reg;    // Register address
+    uint8_t val;    // Register value
+} OV2640_Reg_t;
+
 /* OV2640 Image Formats */
 typedef enum {
     OV2640_FORMAT_JPEG_QQVGA = 0,  // 160x120 JPEG
     OV2640_FORMAT_JPEG_QVGA,       // 320x240 JPEG
+    OV2640_FORMAT_JPEG_CIF,        // 352x288 JPEG
+    OV2640_FORMAT_JPEG_SVGA,       // 800x600 JPEG
+    OV2640_FORMAT_COUNT
 } OV2640_Format_t;
 
+/* Last written value of every register in both banks (0xFF = 0 DSP, 1 sensor) */
+typedef struct {
+    uint8_t value[2][256];
+    uint8_t valid[2][32];          // One bit per register, 0 = unknown
+    uint8_t bank;                  // Current 0xFF value, 0xFF = unknown
+} OV2640_Shadow_t;
+
+/* JPEG quality scale (DSP 0x44): lower is better quality, larger frames */
+#define OV2640_QS_MIN       2
+#define OV2640_QS_MAX       63
+#define OV2640_QS_DEFAULT   12      // Sensor reset value
+
+/* Largest register delta a format switch can produce */
+#define OV2640_DELTA_MAX    64
+
 /* OV2640 Status */
 typedef enum {
     OV2640_OK = 0,
     OV2640_ERROR,
     OV2640_TIMEOUT,
-    OV2640_ID_ERROR
+    OV2640_ID_ERROR,
+    OV2640_OVERRUN      // Frame larger than the capture buffer (truncated)
 } OV2640_Status_t;
 
+/* Capture state (updated from DCMI/DMA interrupt context) */
+typedef enum {
+    OV2640_CAPTURE_IDLE = 0,
+    OV2640_CAPTURE_BUSY,        // Waiting for frame end
+    OV2640_CAPTURE_DONE,        // Frame end received
+    OV2640_CAPTURE_OVERRUN,     // DMA wrapped before frame end
+    OV2640_CAPTURE_ERROR        // DCMI sync/overflow error
+} OV2640_CaptureState_t;
+
+/* SCCB register sequence engine state */
+typedef enum {
+    OV2640_SCCB_IDLE = 0,
+    OV2640_SCCB_BUSY,           // Register write in flight
+    OV2640_SCCB_DELAY,          // Waiting after a COM7 software reset
+    OV2640_SCCB_ERROR           // Write failed, queue dropped
+} OV2640_SccbState_t;
+
 /* Function Prototypes */
 OV2640_Status_t OV2640_Init(OV2640_Format_t format);
+OV2640_Status_t OV2640_InitAsync(OV2640_Format_t format);
+OV2640_Status_t OV2640_WaitReady(uint32_t timeout_ms);
+OV2640_Status_t OV2640_SetFormat(OV2640_Format_t format);
+OV2640_Format_t OV2640_GetFormat(void);
+uint32_t OV2640_GetFrameSizeHint(OV2640_Format_t format);
+
+/* JPEG quality control */
+OV2640_Status_t OV2640_SetQualityScale(uint8_t qs);
+uint8_t OV2640_GetQualityScale(void);
+void OV2640_SetFrameBudget(uint32_t bytes);
+uint32_t OV2640_FrameBudget(uint32_t baudrate, uint32_t period_ms, uint32_t sharePercent);
+uint8_t OV2640_NextQualityScale(uint8_t qs, uint32_t frameBytes, uint32_t budget, bool truncated);
 OV2640_Status_t OV2640_ReadID(uint16_t *id);
 OV2640_Status_t OV2640_StartCapture(uint8_t *buffer, uint32_t buffer_size);
 OV2640_Status_t OV2640_StopCapture(void);
+OV2640_CaptureState_t OV2640_GetCaptureState(void);
+uint32_t OV2640_GetFrameTimestamp(void);
+OV2640_Status_t OV2640_WaitCapture(uint32_t timeout_ms, uint32_t *length);
+OV2640_Status_t OV2640_CaptureFrame(uint8_t *buffer, uint32_t buffer_size,
+                                    uint32_t timeout_ms, uint32_t *length);
+
+/* Interrupt callbacks (to be called from stm32f4xx_it.c) */
+void OV2640_FrameEventCallback(void);
+void OV2640_VsyncEventCallback(void);
+void OV2640_ErrorCallback(void);
+void OV2640_SccbTxCpltCallback(void);
+void OV2640_SccbErrorCallback(void);
+void OV2640_SccbTick(void);
 
 /* Low-level SCCB (I2C) functions */
 OV2640_Status_t OV2640_WriteReg(uint8_t reg, uint8_t data);
 OV2640_Status_t OV2640_ReadReg(uint8_t reg, uint8_t *data);
 
+/* Interrupt-driven SCCB register sequences */
+OV2640_Status_t OV2640_WriteSequence(const OV2640_Reg_t *regs, uint16_t count);
+OV2640_SccbState_t OV2640_GetSccbState(void);
+OV2640_Status_t OV2640_SccbWait(uint32_t timeout_ms);
+
+/* Register shadow and delta computation (pure, for unit testing) */
+void OV2640_ShadowReset(OV2640_Shadow_t *shadow);
+void OV2640_ShadowWrite(OV2640_Shadow_t *shadow, uint8_t reg, uint8_t val);
+OV2640_Status_t OV2640_BuildDelta(const OV2640_Shadow_t *shadow, const OV2640_Reg_t *table,
+                                  uint16_t count, OV2640_Reg_t *delta, uint16_t maxDelta,
+                                  uint16_t *deltaCount);
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,12 +11,7 @@
 #define __OV2640_REGS_H
 
 #include <stdint.h>
-
-/* OV2640 Register Structure */
-typedef struct {
-    uint8_t reg;    // Register address
-    uint8_t val;    // Register value
-} OV2640_Reg_t;
+#include "ov2640.h"
 
 /* OV2640 SCCB (I2C) Address */
 #define OV2640_SCCB_ADDR    0x60  // 7-bit address: 0x30, left shifted: 0x60
@@ -204,10 +199,86 @@ const OV2640_Reg_t OV2640_JPEG_QVGA[] = {
     {0xE0, 0x00},
 };
 
+/* ============================================================
+ * OV2640 352x288 (CIF) JPEG Resolution
+ * Same register set as QQVGA/QVGA so runtime switches are register deltas
+ * ============================================================ */
+const OV2640_Reg_t OV2640_JPEG_CIF[] = {
+    {0xFF, 0x01},
+    {0x12, 0x40},
+    {0x17, 0x11},
+    {0x18, 0x43},
+    {0x19, 0x00},
+    {0x1A, 0x25},
+    {0x32, 0x89},
+    {0x37, 0xC0},
+    {0x4F, 0xCA},
+    {0x50, 0xA8},
+    {0x5A, 0x23},
+    {0x6D, 0x00},
+    {0x3D, 0x38},
+    {0xFF, 0x00},
+    {0xE0, 0x04},
+    {0xC0, 0xC8},
+    {0xC1, 0x96},
+    {0x86, 0x3D},
+    {0x50, 0x89},
+    {0x51, 0x90},
+    {0x52, 0x2C},
+    {0x53, 0x00},
+    {0x54, 0x00},
+    {0x55, 0x88},
+    {0x57, 0x00},
+    {0x5A, 0x58}, // 352 / 4
+    {0x5B, 0x48}, // 288 / 4
+    {0x5C, 0x00},
+    {0xD3, 0x04},
+    {0xE0, 0x00},
+};
+
+/* ============================================================
+ * OV2640 800x600 (SVGA) JPEG Resolution
+ * Sensor back in SVGA mode (window as in OV2640_SVGA_Init)
+ * ============================================================ */
+const OV2640_Reg_t OV2640_JPEG_SVGA[] = {
+    {0xFF, 0x01},
+    {0x12, 0x00}, // SVGA mode
+    {0x17, 0x11},
+    {0x18, 0x75},
+    {0x19, 0x01},
+    {0x1A, 0x97},
+    {0x32, 0x36},
+    {0x37, 0x40},
+    {0x4F, 0xBB},
+    {0x50, 0x9C},
+    {0x5A, 0x57},
+    {0x6D, 0x80},
+    {0x3D, 0x34},
+    {0xFF, 0x00},
+    {0xE0, 0x04},
+    {0xC0, 0xC8},
+    {0xC1, 0x96},
+    {0x86, 0x3D},
+    {0x50, 0x89},
+    {0x51, 0x90},
+    {0x52, 0x2C},
+    {0x53, 0x00},
+    {0x54, 0x00},
+    {0x55, 0x88},
+    {0x57, 0x00},
+    {0x5A, 0xC8}, // 800 / 4
+    {0x5B, 0x96}, // 600 / 4
+    {0x5C, 0x00},
+    {0xD3, 0x04},
+    {0xE0, 0x00},
+};
+
 /* Array sizes */
 #define OV2640_SVGA_INIT_SIZE    (sizeof(OV2640_SVGA_Init) / sizeof(OV2640_Reg_t))
 #define OV2640_JPEG_INIT_SIZE    (sizeof(OV2640_JPEG_Init) / sizeof(OV2640_Reg_t))
 #define OV2640_JPEG_QQVGA_SIZE   (sizeof(OV2640_JPEG_QQVGA) / sizeof(OV2640_Reg_t))
 #define OV2640_JPEG_QVGA_SIZE    (sizeof(OV2640_JPEG_QVGA) / sizeof(OV2640_Reg_t))
+#define OV2640_JPEG_CIF_SIZE     (sizeof(OV2640_JPEG_CIF) / sizeof(OV2640_Reg_t))
+#define OV2640_JPEG_SVGA_SIZE    (sizeof(OV2640_JPEG_SVGA) / sizeof(OV2640_Reg_t))
 
 #endif /* __OV2640_REGS_H */
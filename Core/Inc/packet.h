@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ * @file    packet.h
+ * @brief   Channel-multiplexed packet framing (COBS + CRC-16) for USART1
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __PACKET_H
+#define __PACKET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Channel IDs (console text is sent unframed between packets) */
+#define PACKET_CHANNEL_TELEMETRY    0x01U   // Binary scan records
+#define PACKET_CHANNEL_IMAGE        0x02U   // JPEG frame chunks
+
+/* Image chunk payload: frame id (u16), offset (u32), total length (u32), data */
+#define PACKET_IMAGE_HEADER_SIZE    10U
+#define PACKET_IMAGE_CHUNK_SIZE     256U
+
+/* Channel + length header and CRC-16 trailer around the payload */
+#define PACKET_OVERHEAD             5U
+
+/* Worst-case bytes on the wire for a payload of n bytes:
+ * overhead, COBS code bytes and the two 0x00 delimiters
+ */
+#define PACKET_WIRE_SIZE(n)         ((n) + PACKET_OVERHEAD + (((n) + PACKET_OVERHEAD) / 254U) + 1U + 2U)
+
+/* Incremental encoder, lets a payload be gathered from several buffers */
+typedef struct {
+    uint8_t *output;                // Destination buffer
+    size_t length;                  // Bytes written so far
+    size_t codeIndex;               // Position of the pending COBS code byte
+    uint8_t code;                   // Current COBS code value
+    uint16_t crc;                   // Running CRC over header and payload
+} Packet_Encoder_t;
+
+/* Function prototypes */
+void Packet_Begin(Packet_Encoder_t *encoder, uint8_t *output, uint8_t channel, uint16_t length);
+void Packet_Append(Packet_Encoder_t *encoder, const uint8_t *data, size_t length);
+size_t Packet_End(Packet_Encoder_t *encoder);
+size_t Packet_Encode(uint8_t *output, uint8_t channel, const uint8_t *payload, uint16_t length);
+
+/* Pure helpers for unit testing and decoding */
+uint16_t Packet_Crc16(const uint8_t *data, size_t length);
+size_t Packet_CobsEncode(const uint8_t *input, size_t length, uint8_t *output);
+size_t Packet_CobsDecode(const uint8_t *input, size_t length, uint8_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PACKET_H */
@@ -0,0 +1,48 @@
+/**
+ ******************************************************************************
+ * @file    ring_buffer.h
+ * @brief   Lock-free single-producer/single-consumer ring of fixed-size
+ *          elements
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __RING_BUFFER_H
+#define __RING_BUFFER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Ring state. Indices are free running; only the producer writes head and
+ * dropped, only the consumer writes tail. */
+typedef struct {
+    uint8_t *storage;               // capacity * elementSize bytes
+    uint32_t elementSize;           // Bytes per element
+    uint32_t mask;                  // capacity - 1
+    volatile uint32_t head;         // Elements pushed
+    volatile uint32_t tail;         // Elements popped
+    volatile uint32_t dropped;      // Pushes lost to a full ring
+} Ring_t;
+
+/* Function prototypes */
+bool Ring_Init(Ring_t *ring, void *storage, uint32_t elementSize, uint32_t capacity);
+
+/* Producer side */
+bool Ring_Push(Ring_t *ring, const void *element);
+
+/* Consumer side */
+bool Ring_Pop(Ring_t *ring, void *element);
+void Ring_Discard(Ring_t *ring);
+
+/* Either side */
+uint32_t Ring_Count(const Ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RING_BUFFER_H */
@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ * @file    scan_pipeline.h
+ * @brief   Stop-and-go scan as a pipeline of event-driven stages
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __SCAN_PIPELINE_H
+#define __SCAN_PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Scan pattern: pan 0-180 degrees in steps, tilt fixed */
+#define SCAN_PAN_STEP_DEG       30.0f
+#define SCAN_TILT_DEG           90.0f
+
+/* Range samples taken at rest per stop (one per 60 ms slot) */
+#define SCAN_RANGE_SAMPLES      2U
+
+/* Max time for one frame (incl. next VSYNC) */
+#define SCAN_CAPTURE_TIMEOUT_MS 200U
+
+/* Completion events and conditions fed into ScanPipeline_Step() */
+#define SCAN_EV_ARRIVED         0x01U   // Gimbal at rest on the stop
+#define SCAN_EV_RANGE           0x02U   // One range sample completed
+#define SCAN_EV_BUFFER_FREE     0x04U   // A buffer fitting the frame size hint is free
+#define SCAN_EV_FRAME_DONE      0x08U   // Capture finished (any status)
+#define SCAN_EV_FRAME_PENDING   0x10U   // A ready frame waits and the link is free
+#define SCAN_EV_TX_DONE         0x20U   // Image transfer finished
+
+/* Actions returned by ScanPipeline_Step(), executed in this order */
+#define SCAN_ACT_RANGE_START    0x01U   // Drop the filter, count fresh samples
+#define SCAN_ACT_CAPTURE_START  0x02U   // Acquire a buffer, start DCMI
+#define SCAN_ACT_REPORT         0x04U   // Send the telemetry of the stop
+#define SCAN_ACT_MOVE           0x08U   // Start the move to the next stop
+#define SCAN_ACT_TX_START       0x10U   // Queue the oldest ready frame
+
+/* Stage state */
+typedef enum {
+    SCAN_STAGE_IDLE = 0,
+    SCAN_STAGE_WAITING,         // Waiting for a resource (frame buffer)
+    SCAN_STAGE_BUSY,            // Started, waiting for completion
+    SCAN_STAGE_DONE             // Finished for this stop
+} ScanStage_t;
+
+/* Pipeline state: the gimbal stage owns the stops, the range and capture
+ * stages run in parallel while it holds still, the transmit stage drains
+ * frames independently of the stops. */
+typedef struct {
+    ScanStage_t motion;         // BUSY = moving, DONE = holding at the stop
+    ScanStage_t range;
+    ScanStage_t capture;
+    ScanStage_t transmit;
+    uint8_t rangeCount;         // Samples since SCAN_ACT_RANGE_START
+    bool camera;                // Capture stage enabled
+    bool ranger;                // Range stage enabled
+} ScanPipeline_t;
+
+/* Function prototypes */
+void ScanPipeline_Start(bool camera, bool ranger);
+
+/* Pure calculation functions for unit testing */
+void ScanPipeline_Reset(ScanPipeline_t *pipe, bool camera, bool ranger);
+uint32_t ScanPipeline_Step(ScanPipeline_t *pipe, uint32_t events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCAN_PIPELINE_H */
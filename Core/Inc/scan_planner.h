@@ -0,0 +1,59 @@
+/**
+ ******************************************************************************
+ * @file    scan_planner.h
+ * @brief   Adaptive pan stop planner: coarse pass, then bisection of range
+ *          discontinuities within a time budget
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __SCAN_PLANNER_H
+#define __SCAN_PLANNER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Pan range and coarse pass */
+#define SCAN_PLAN_MIN_DEG       0.0f
+#define SCAN_PLAN_MAX_DEG       180.0f
+#define SCAN_PLAN_COARSE_DEG    30.0f
+
+/* Refinement: bisect neighbours whose ranges differ by more than
+ * SCAN_PLAN_EDGE_MM (or where only one has an echo), down to a spacing of
+ * SCAN_PLAN_FINE_DEG (30 / 16) */
+#define SCAN_PLAN_EDGE_MM       100U
+#define SCAN_PLAN_FINE_DEG      1.875f
+
+/* Time per sweep (coarse pass + refinement) and stop table size */
+#define SCAN_PLAN_BUDGET_MS     12000U
+#define SCAN_PLAN_MAX_POINTS    48U
+
+/* One measured stop */
+typedef struct {
+    float angle;                // Pan angle in degrees
+    uint16_t distance_mm;       // Filtered range, valid only if valid
+    bool valid;                 // Echo received
+} ScanPoint_t;
+
+/* Plan of one sweep */
+typedef struct {
+    ScanPoint_t points[SCAN_PLAN_MAX_POINTS];   // Measured stops, ascending angle
+    uint8_t count;
+    uint8_t coarseNext;         // Coarse stops handed out
+    bool descending;            // Coarse pass runs 180 -> 0
+} ScanPlan_t;
+
+/* Pure calculation functions for unit testing */
+void ScanPlan_Reset(ScanPlan_t *plan);
+void ScanPlan_Record(ScanPlan_t *plan, float angle, uint16_t distance_mm, bool valid);
+bool ScanPlan_Next(ScanPlan_t *plan, float current, uint32_t elapsed_ms, float *angle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCAN_PLANNER_H */
@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @file    serial_link.h
+ * @brief   USART1 DMA transmit link for log text and image data
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __SERIAL_LINK_H
+#define __SERIAL_LINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+
+/* Log ring buffer size in bytes (must be a power of two) */
+#ifndef SERIAL_LINK_LOG_SIZE
+#define SERIAL_LINK_LOG_SIZE        2048U
+#endif
+
+/* Receive ring size in bytes (must be a power of two) */
+#ifndef SERIAL_LINK_RX_SIZE
+#define SERIAL_LINK_RX_SIZE         256U
+#endif
+
+/* Behaviour when the log ring buffer is full */
+typedef enum {
+    SERIAL_LINK_POLICY_BLOCK = 0,   // Wait for the DMA to make room
+    SERIAL_LINK_POLICY_DROP         // Discard the bytes and count them
+} SerialLink_Policy_t;
+
+/* Default policy (override with -DSERIAL_LINK_LOG_POLICY=SERIAL_LINK_POLICY_DROP) */
+#ifndef SERIAL_LINK_LOG_POLICY
+#define SERIAL_LINK_LOG_POLICY      SERIAL_LINK_POLICY_BLOCK
+#endif
+
+/* Link status */
+typedef enum {
+    SERIAL_LINK_OK = 0,
+    SERIAL_LINK_BUSY,
+    SERIAL_LINK_ERROR
+} SerialLink_Status_t;
+
+/* Transfer complete callback (called from interrupt context) */
+typedef void (*SerialLink_TxCallback_t)(void);
+
+/* Function prototypes */
+SerialLink_Status_t SerialLink_SendAsync(uint8_t channel, uint16_t id, const uint8_t *data,
+                                         uint32_t length, SerialLink_TxCallback_t callback);
+bool SerialLink_IsBusy(void);
+void SerialLink_WaitIdle(void);
+
+/* Log ring buffer (backs printf via _write, also carries telemetry packets) */
+uint32_t SerialLink_Write(const uint8_t *data, uint32_t length);
+void SerialLink_SetLogPolicy(SerialLink_Policy_t policy);
+uint32_t SerialLink_GetLogDropped(void);
+
+/* Receive ring (backs scanf via __io_getchar) */
+void SerialLink_StartReceive(void);
+bool SerialLink_ReadByte(uint8_t *byte);
+uint32_t SerialLink_GetRxDropped(void);
+
+/* Interrupt callbacks (to be called from stm32f4xx_it.c) */
+void SerialLink_TxCpltCallback(void);
+void SerialLink_ErrorCallback(void);
+void SerialLink_RxIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SERIAL_LINK_H */
@@ -33,6 +33,7 @@ extern "C" {
 void Servo_Init(void);
 void Servo_SetAngle(uint32_t channel, float angle);
 void Servo_SetPulse(uint32_t channel, uint16_t pulse);
+uint32_t Servo_GetCommandTime(uint32_t channel);
 
 /* Pure calculation function for unit testing */
 uint16_t Servo_AngleToPulse(float angle);
@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @file    servo_motion.h
+ * @brief   Trapezoidal servo trajectories on top of servo_driver with
+ *          arrival-time prediction
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __SERVO_MOTION_H
+#define __SERVO_MOTION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f4xx_hal.h"
+#include <stdbool.h>
+
+/* One setpoint per PWM frame, from the TIM4 update interrupt */
+#define MOTION_PERIOD_MS        20U
+
+/* Profile limits, kept below the SG90 no-load slew (~0.1 s/60 deg at 5 V)
+ * so the horn can follow the setpoints */
+#define MOTION_MAX_SPEED_DPS    450.0f      // Cruise speed, deg/s
+#define MOTION_ACCEL_DPS2       6000.0f     // Acceleration and braking, deg/s^2
+
+/* A setpoint this close to the target has landed (float rounding; far
+ * below the 0.09 degree resolution of the 1 us pulse step) */
+#define MOTION_LAND_DEG         0.001f
+
+/* Lag of the horn behind the last setpoint until it is at rest */
+#define MOTION_SETTLE_MS        60U
+
+/* Commanded trajectory kept per axis for angle lookups (power of two),
+ * 32 setpoints = 640 ms of motion */
+#define MOTION_HISTORY_LEN      32U
+
+/* Setpoint generator state of one axis */
+typedef struct {
+    float position;         // Current setpoint, deg
+    float velocity;         // Signed setpoint speed, deg/s
+    float target;           // Final angle, deg
+    float maxSpeed;         // Cruise speed of this move, deg/s
+} Motion_Profile_t;
+
+/* Commanded angle and the time it takes effect on the PWM output */
+typedef struct {
+    uint32_t time_us;       // Timebase
+    float angle;            // deg
+} Motion_Point_t;
+
+/* Function prototypes */
+void Motion_Init(void);
+void Motion_MoveTo(uint32_t channel, float angle);
+void Motion_Sweep(uint32_t channel, float angle, float speed_dps);
+bool Motion_AngleAt(uint32_t channel, uint32_t time_us, float *angle);
+bool Motion_Arrived(uint32_t channel);
+uint32_t Motion_GetArrivalTime(uint32_t channel);
+uint32_t Motion_GetWaitTime_ms(void);
+float Motion_GetSetpoint(uint32_t channel);
+
+/* Interrupt callback (to be called from stm32f4xx_it.c) */
+void Motion_UpdateCallback(TIM_HandleTypeDef *htim);
+
+/* Pure calculation functions for unit testing */
+bool Motion_ProfileStep(Motion_Profile_t *profile, float dt);
+uint32_t Motion_MoveTime_ms(const Motion_Profile_t *profile);
+bool Motion_Interpolate(const Motion_Point_t *points, uint32_t count, uint32_t time_us, float *angle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SERVO_MOTION_H */
@@ -0,0 +1,68 @@
+/**
+ ******************************************************************************
+ * @file    telemetry.h
+ * @brief   Scan telemetry output: text lines and COBS-framed binary records
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "packet.h"
+
+/* Binary record format version (bump on any layout change) */
+#define TELEMETRY_VERSION           1
+
+/* Serialized record: version, flags, seq, timestamp, pan, tilt, distance */
+#define TELEMETRY_RECORD_SIZE       14
+/* Record wrapped in a PACKET_CHANNEL_TELEMETRY packet */
+#define TELEMETRY_FRAME_MAX         PACKET_WIRE_SIZE(TELEMETRY_RECORD_SIZE)
+
+/* Status flags */
+#define TELEMETRY_FLAG_RANGE_VALID      0x01U   // Distance measurement succeeded
+#define TELEMETRY_FLAG_RANGE_TIMEOUT    0x02U   // No echo received
+#define TELEMETRY_FLAG_IMAGE_CAPTURED   0x04U   // Camera frame captured
+#define TELEMETRY_FLAG_IMAGE_TRUNCATED  0x08U   // Frame did not fit into buffer (dropped)
+
+/* Output mode */
+typedef enum {
+    TELEMETRY_MODE_TEXT = 0,        // "Pan: ... | Tilt: ... | Distance: ..." lines
+    TELEMETRY_MODE_BINARY,          // COBS-framed binary records only
+    TELEMETRY_MODE_BOTH             // Text line followed by binary record
+} Telemetry_Mode_t;
+
+/* Default mode (CMake: -DTELEMETRY_MODE=TEXT|BINARY|BOTH) */
+#ifndef TELEMETRY_DEFAULT_MODE
+#define TELEMETRY_DEFAULT_MODE      TELEMETRY_MODE_TEXT
+#endif
+
+/* One scan sample (fixed point, no floats on the output path) */
+typedef struct {
+    uint32_t timestamp_ms;          // HAL tick at measurement
+    int16_t pan_cdeg;               // Pan angle in 0.01 degree
+    int16_t tilt_cdeg;              // Tilt angle in 0.01 degree
+    uint16_t distance_mm;           // Distance in millimetres
+    uint8_t flags;                  // TELEMETRY_FLAG_*
+} Telemetry_Sample_t;
+
+/* Function prototypes */
+void Telemetry_SetMode(Telemetry_Mode_t mode);
+Telemetry_Mode_t Telemetry_GetMode(void);
+void Telemetry_Send(const Telemetry_Sample_t *sample);
+
+/* Pure encoding functions for unit testing */
+size_t Telemetry_Serialize(const Telemetry_Sample_t *sample, uint16_t sequence, uint8_t *output);
+size_t Telemetry_EncodeFrame(const Telemetry_Sample_t *sample, uint16_t sequence, uint8_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TELEMETRY_H */
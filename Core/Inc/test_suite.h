@@ -58,7 +58,22 @@ void Run_All_Tests(void);
 
 /* Individual test functions */
 bool Test_Servo_AngleToPulse(void);
+bool Test_Motion_Profile(void);
+bool Test_Motion_Sweep(void);
 bool Test_HCSR04_PulseToDistance(void);
+bool Test_HCSR04_FixedPoint(void);
+bool Test_HCSR04_Filter(void);
+bool Test_HCSR04_Schedule(void);
+bool Test_HCSR04_Echoes(void);
+bool Test_Timebase_Extend(void);
+bool Test_Packet_Encoding(void);
+bool Test_Telemetry_Frame(void);
+bool Test_OV2640_FormatDelta(void);
+bool Test_OV2640_QualityScale(void);
+bool Test_ScanPipeline(void);
+bool Test_ScanPlan(void);
+bool Test_Ring(void);
+bool Test_EventLoop(void);
 
 #ifdef __cplusplus
 }
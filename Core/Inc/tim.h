@@ -32,6 +32,10 @@ extern "C" {
 
 /* USER CODE END Includes */
 
+extern TIM_HandleTypeDef htim1;
+
+extern TIM_HandleTypeDef htim2;
+
 extern TIM_HandleTypeDef htim3;
 
 extern TIM_HandleTypeDef htim4;
@@ -40,6 +44,8 @@ extern TIM_HandleTypeDef htim4;
 
 /* USER CODE END Private defines */
 
+void MX_TIM1_Init(void);
+void MX_TIM2_Init(void);
 void MX_TIM3_Init(void);
 void MX_TIM4_Init(void);
 
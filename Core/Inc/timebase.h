@@ -0,0 +1,32 @@
+/**
+ ******************************************************************************
+ * @file    timebase.h
+ * @brief   Shared 32-bit microsecond clock on TIM2
+ * @author  Generated for STM32F407 Project
+ ******************************************************************************
+ */
+
+#ifndef __TIMEBASE_H
+#define __TIMEBASE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Function prototypes */
+void Timebase_Init(void);
+uint32_t Timebase_Now(void);
+uint32_t Timebase_Extend16(uint32_t stamp16);
+void Timebase_SetAlarm(uint32_t time_us);
+void Timebase_ClearAlarm(void);
+
+/* Pure calculation function for unit testing */
+uint32_t Timebase_Extend(uint32_t now, uint32_t stamp16);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TIMEBASE_H */
@@ -0,0 +1,225 @@
+/**
+ ******************************************************************************
+ * @file    event_loop.c
+ * @brief   Run-to-completion event loop with an interrupt-fed queue and
+ *          software timers
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    Interrupt callbacks (HC-SR04 window, DCMI frame, UART DMA done)
+ *          only post an event; the work happens in the handler subscribed
+ *          to it, called from the main loop one event at a time. Software
+ *          timers run on the HAL tick (SysTick, 1 ms) and post their event
+ *          when they expire. Nothing in the loop blocks: a subsystem that
+ *          has to wait arms a timer or waits for its completion event, and
+ *          the core sleeps in Event_Idle() while there is nothing to do.
+ *
+ *          With TICKLESS_IDLE the 1 ms SysTick interrupt is suspended for
+ *          the sleep and a TIM2 compare wakes the core on the tick of the
+ *          next timer expiry. The SysTick counter keeps running, so its
+ *          phase is kept; the ticks it counted silently are added to the
+ *          HAL tick from the microsecond clock before interrupts are let
+ *          in again. The core only enters Sleep: TIM1-4, DMA and DCMI
+ *          keep their clocks, so range captures and servo PWM run on and
+ *          their interrupts wake the core as before.
+ *
+ *          The queue is an SPSC ring (ring_buffer.c) of Event_t: the main
+ *          loop pops without masking interrupts. Posts may come from
+ *          interrupts of different priorities, so Event_Post() serializes
+ *          the producers with a short critical section. Timers and
+ *          handlers belong to the main loop. The timer table arithmetic is
+ *          in event_timer.c.
+ ******************************************************************************
+ */
+
+#include "event_loop.h"
+#include "main.h"
+#include "timebase.h"
+
+#if (EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1U)) != 0U
+#error "EVENT_QUEUE_SIZE must be a power of two"
+#endif
+
+/* Private variables */
+static Event_t eventStorage[EVENT_QUEUE_SIZE];
+static Ring_t eventQueue;
+static EventTimer_t eventTimers[EVENT_MAX_TIMERS];
+static Event_Handler_t eventHandlers[EVENT_COUNT];
+
+/**
+ * @brief  Clear the queue, timers and subscriptions
+ * @param  None
+ * @retval None
+ */
+void Event_Init(void)
+{
+    Ring_Init(&eventQueue, eventStorage, sizeof(Event_t), EVENT_QUEUE_SIZE);
+
+    for (uint32_t i = 0; i < EVENT_MAX_TIMERS; i++) {
+        eventTimers[i].active = false;
+    }
+    for (uint32_t i = 0; i < EVENT_COUNT; i++) {
+        eventHandlers[i] = NULL;
+    }
+}
+
+/**
+ * @brief  Set the handler of an event
+ * @param  id: Event identifier
+ * @param  handler: Handler, NULL to ignore the event
+ * @retval None
+ * @note   One handler per event; a later call replaces the earlier one.
+ */
+void Event_Subscribe(EventId_t id, Event_Handler_t handler)
+{
+    if (id < EVENT_COUNT) {
+        eventHandlers[id] = handler;
+    }
+}
+
+/**
+ * @brief  Queue an event
+ * @param  id: Event identifier
+ * @param  arg: Event specific argument
+ * @retval None
+ * @note   Safe from interrupt context. Counted in Event_GetDropped() when
+ *         the queue is full.
+ */
+void Event_Post(EventId_t id, uint16_t arg)
+{
+    Event_t event = { (uint16_t)id, arg };
+
+    /* Several interrupt priorities post: one producer at a time */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Ring_Push(&eventQueue, &event);
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Start (or restart) the timer of an event
+ * @param  id: Event posted on expiry
+ * @param  delay_ms: Time to the first expiry
+ * @param  period_ms: Reload period, 0 for a one-shot timer
+ * @retval None
+ * @note   Main loop only. An event has at most one timer.
+ */
+void Event_StartTimer(EventId_t id, uint32_t delay_ms, uint32_t period_ms)
+{
+    if (!EventTimer_Arm(eventTimers, EVENT_MAX_TIMERS, (uint16_t)id,
+                        HAL_GetTick(), delay_ms, period_ms)) {
+        Error_Handler();    // EVENT_MAX_TIMERS too small
+    }
+}
+
+/**
+ * @brief  Stop the timer of an event
+ * @param  id: Event identifier
+ * @retval None
+ * @note   Main loop only. An expiry already queued is still delivered.
+ */
+void Event_StopTimer(EventId_t id)
+{
+    EventTimer_Disarm(eventTimers, EVENT_MAX_TIMERS, (uint16_t)id);
+}
+
+/**
+ * @brief  Fire expired timers and run the handlers of all queued events
+ * @param  None
+ * @retval None
+ * @note   Call from the main loop. Events posted by handlers are run in the
+ *         same call.
+ */
+void Event_Dispatch(void)
+{
+    Event_t event;
+
+    /* Expiries are pushed from the main loop, a producer like the
+     * interrupts: keep them out of each other's way */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    EventTimer_Expire(eventTimers, EVENT_MAX_TIMERS, HAL_GetTick(), &eventQueue);
+    __set_PRIMASK(primask);
+
+    while (Ring_Pop(&eventQueue, &event)) {
+        if (event.id < EVENT_COUNT && eventHandlers[event.id] != NULL) {
+            eventHandlers[event.id](&event);
+        }
+    }
+}
+
+#ifdef TICKLESS_IDLE
+/**
+ * @brief  Sleep with SysTick suspended until a tick count has elapsed
+ * @param  ticks: HAL ticks to sleep at most (>= 1)
+ * @retval None
+ * @note   Called with interrupts masked. Any other interrupt ends the sleep
+ *         early. A tick boundary in the few cycles between the wake-up
+ *         reading and HAL_ResumeTick() is lost (HAL tick 1 ms late).
+ */
+static void Event_SleepTicks(uint32_t ticks)
+{
+    HAL_SuspendTick();
+
+    /* A tick that came while masked is still pending: let it run first */
+    if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0U) {
+        HAL_ResumeTick();
+        return;
+    }
+
+    /* Counter cycles left in the current tick, then the wake-up alarm on
+     * the boundary where the HAL tick reaches the timer */
+    uint32_t toTick_us = SysTick->VAL / (SystemCoreClock / 1000000U);
+    uint32_t start = Timebase_Now();
+    Timebase_SetAlarm(start + toTick_us + (ticks - 1U) * EVENT_TICK_US);
+
+    __WFI();
+
+    uint32_t slept_us = Timebase_Now() - start;
+    Timebase_ClearAlarm();
+    uwTick += EventTimer_MissedTicks(toTick_us, slept_us) * (uint32_t)uwTickFreq;
+    HAL_ResumeTick();
+}
+#endif
+
+/**
+ * @brief  Sleep until the next interrupt if no event is queued
+ * @param  tickless: false while something counts on every SysTick
+ *         (e.g. the SCCB reset delay)
+ * @retval None
+ * @note   The queue is checked with interrupts masked, so an event posted
+ *         just before the check is not slept through (a pending interrupt
+ *         still ends WFI while masked). Without TICKLESS_IDLE, SysTick
+ *         wakes the core every 1 ms for the timers.
+ */
+void Event_Idle(bool tickless)
+{
+    __disable_irq();
+    if (Ring_Count(&eventQueue) == 0U) {
+#ifdef TICKLESS_IDLE
+        uint32_t delay_ms = EventTimer_NextDue(eventTimers, EVENT_MAX_TIMERS, HAL_GetTick());
+        if (delay_ms > EVENT_TICKLESS_MAX_MS) {
+            delay_ms = EVENT_TICKLESS_MAX_MS;
+        }
+
+        if (tickless && delay_ms >= EVENT_TICKLESS_MIN_MS) {
+            Event_SleepTicks(delay_ms);
+        } else {
+            __WFI();
+        }
+#else
+        (void)tickless;
+        __WFI();
+#endif
+    }
+    __enable_irq();
+}
+
+/**
+ * @brief  Number of events lost to a full queue
+ * @param  None
+ * @retval Dropped event count
+ */
+uint32_t Event_GetDropped(void)
+{
+    return eventQueue.dropped;
+}
@@ -0,0 +1,151 @@
+/**
+ ******************************************************************************
+ * @file    event_timer.c
+ * @brief   Software timer table of the event loop (pure calculations)
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    Timer arithmetic for event_loop.c, kept free of HAL and CMSIS
+ *          so that it builds and is tested on the host as well
+ *          (tests/host). Times are HAL ticks (1 ms) compared by signed
+ *          difference, so the 32-bit tick may wrap.
+ ******************************************************************************
+ */
+
+#include "event_loop.h"
+#include <stddef.h>
+
+/**
+ * @brief  Arm the timer of an event (pure calculation for testing)
+ * @param  timers: Timer table
+ * @param  count: Entries in the table
+ * @param  id: Event posted on expiry
+ * @param  now: Current tick
+ * @param  delay_ms: Time to the first expiry
+ * @param  period_ms: Reload period, 0 for a one-shot timer
+ * @retval false if the event has no timer yet and the table is full
+ * @note   Re-arming the timer of an event reuses its entry.
+ */
+bool EventTimer_Arm(EventTimer_t *timers, uint32_t count, uint16_t id,
+                    uint32_t now, uint32_t delay_ms, uint32_t period_ms)
+{
+    EventTimer_t *slot = NULL;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (timers[i].active && timers[i].id == id) {
+            slot = &timers[i];
+            break;
+        }
+        if (!timers[i].active && slot == NULL) {
+            slot = &timers[i];
+        }
+    }
+
+    if (slot == NULL) {
+        return false;
+    }
+
+    slot->id = id;
+    slot->due = now + delay_ms;
+    slot->period = period_ms;
+    slot->active = true;
+    return true;
+}
+
+/**
+ * @brief  Disarm the timer of an event (pure calculation for testing)
+ * @param  timers: Timer table
+ * @param  count: Entries in the table
+ * @param  id: Event identifier
+ * @retval None
+ */
+void EventTimer_Disarm(EventTimer_t *timers, uint32_t count, uint16_t id)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (timers[i].active && timers[i].id == id) {
+            timers[i].active = false;
+        }
+    }
+}
+
+/**
+ * @brief  Post the events of expired timers (pure calculation for testing)
+ * @param  timers: Timer table
+ * @param  count: Entries in the table
+ * @param  now: Current tick
+ * @param  queue: Event ring receiving the events
+ * @retval Number of timers that expired
+ * @note   Ticks are compared by signed difference (wrap-safe). A periodic
+ *         timer fires once per call even if several periods were missed,
+ *         and keeps its phase unless it fell a full period behind.
+ */
+uint32_t EventTimer_Expire(EventTimer_t *timers, uint32_t count, uint32_t now, Ring_t *queue)
+{
+    uint32_t fired = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        EventTimer_t *timer = &timers[i];
+
+        if (!timer->active || (int32_t)(now - timer->due) < 0) {
+            continue;
+        }
+
+        Event_t event = { timer->id, 0 };
+        Ring_Push(queue, &event);
+        fired++;
+
+        if (timer->period == 0U) {
+            timer->active = false;
+        } else {
+            timer->due += timer->period;
+            if ((int32_t)(now - timer->due) >= 0) {
+                timer->due = now + timer->period;
+            }
+        }
+    }
+
+    return fired;
+}
+
+/**
+ * @brief  Time to the next timer expiry (pure calculation for testing)
+ * @param  timers: Timer table
+ * @param  count: Entries in the table
+ * @param  now: Current tick
+ * @retval Ticks until the earliest active timer is due, 0 if one is
+ *         overdue, EVENT_NO_TIMER if none is active
+ */
+uint32_t EventTimer_NextDue(const EventTimer_t *timers, uint32_t count, uint32_t now)
+{
+    uint32_t next = EVENT_NO_TIMER;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!timers[i].active) {
+            continue;
+        }
+
+        int32_t left = (int32_t)(timers[i].due - now);
+        if (left <= 0) {
+            return 0;
+        }
+        if ((uint32_t)left < next) {
+            next = (uint32_t)left;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * @brief  Ticks elapsed during a tickless sleep (pure calculation for testing)
+ * @param  toTick_us: Time from the start of the sleep to the next tick
+ * @param  slept_us: Duration of the sleep
+ * @retval Number of tick boundaries crossed
+ */
+uint32_t EventTimer_MissedTicks(uint32_t toTick_us, uint32_t slept_us)
+{
+    if (slept_us < toTick_us) {
+        return 0;
+    }
+
+    return (slept_us - toTick_us) / EVENT_TICK_US + 1U;
+}
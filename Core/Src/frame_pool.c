@@ -0,0 +1,166 @@
+/**
+ ******************************************************************************
+ * @file    frame_pool.c
+ * @brief   Pool of DMA-capable JPEG frame buffers with ownership states
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    Buffers live in main SRAM (CCM RAM is not reachable by DMA).
+ *          Small buffers hold QQVGA/QVGA frames, the large one CIF/SVGA.
+ *          A buffer moves FREE -> CAPTURING -> READY -> TRANSMITTING -> FREE,
+ *          so the camera can fill one buffer while the UART drains another.
+ *          Release may be called from interrupt context (UART DMA complete);
+ *          every other transition happens in the main loop.
+ ******************************************************************************
+ */
+
+#include "frame_pool.h"
+#include <stddef.h>
+
+/* Private variables */
+__attribute__((aligned(4))) static uint8_t frameMemory[FRAME_POOL_SMALL_COUNT][FRAME_BUFFER_SIZE];
+__attribute__((aligned(4))) static uint8_t frameLargeMemory[FRAME_POOL_LARGE_COUNT][FRAME_LARGE_BUFFER_SIZE];
+static Frame_t frames[FRAME_POOL_COUNT];
+static uint32_t nextSequence = 0;
+
+/**
+ * @brief  Initialize the frame pool (all buffers free)
+ * @param  None
+ * @retval None
+ */
+void FramePool_Init(void)
+{
+    for (uint32_t i = 0; i < FRAME_POOL_COUNT; i++) {
+        if (i < FRAME_POOL_SMALL_COUNT) {
+            frames[i].data = frameMemory[i];
+            frames[i].size = FRAME_BUFFER_SIZE;
+        } else {
+            frames[i].data = frameLargeMemory[i - FRAME_POOL_SMALL_COUNT];
+            frames[i].size = FRAME_LARGE_BUFFER_SIZE;
+        }
+        frames[i].length = 0;
+        frames[i].sequence = 0;
+        frames[i].timestamp_us = 0;
+        frames[i].truncated = 0;
+        frames[i].state = FRAME_FREE;
+    }
+    nextSequence = 0;
+}
+
+/**
+ * @brief  Take a free buffer for capture
+ * @param  minSize: Smallest acceptable buffer size in bytes
+ * @retval Smallest free frame of at least minSize bytes in FRAME_CAPTURING
+ *         state, NULL if none is free
+ */
+Frame_t *FramePool_Acquire(uint32_t minSize)
+{
+    Frame_t *best = NULL;
+
+    for (uint32_t i = 0; i < FRAME_POOL_COUNT; i++) {
+        if (frames[i].state == FRAME_FREE && frames[i].size >= minSize &&
+            (best == NULL || frames[i].size < best->size)) {
+            best = &frames[i];
+        }
+    }
+
+    if (best != NULL) {
+        best->length = 0;
+        best->truncated = 0;
+        best->state = FRAME_CAPTURING;
+    }
+
+    return best;
+}
+
+/**
+ * @brief  Mark a captured buffer as ready for transmission
+ * @param  frame: Frame in FRAME_CAPTURING state
+ * @param  length: JPEG length in bytes
+ * @param  truncated: Non-zero if the frame did not fit into the buffer
+ * @retval None
+ */
+void FramePool_MarkReady(Frame_t *frame, uint32_t length, uint8_t truncated)
+{
+    frame->length = length;
+    frame->truncated = truncated;
+    frame->sequence = nextSequence++;
+    frame->state = FRAME_READY;
+}
+
+/**
+ * @brief  Get the oldest frame waiting for transmission
+ * @param  None
+ * @retval Frame in FRAME_READY state, NULL if none
+ */
+Frame_t *FramePool_NextReady(void)
+{
+    Frame_t *oldest = NULL;
+
+    for (uint32_t i = 0; i < FRAME_POOL_COUNT; i++) {
+        if (frames[i].state == FRAME_READY &&
+            (oldest == NULL || (int32_t)(frames[i].sequence - oldest->sequence) < 0)) {
+            oldest = &frames[i];
+        }
+    }
+
+    return oldest;
+}
+
+/**
+ * @brief  Hand a ready frame over to the UART DMA
+ * @param  frame: Frame in FRAME_READY state
+ * @retval None
+ */
+void FramePool_MarkTransmitting(Frame_t *frame)
+{
+    frame->state = FRAME_TRANSMITTING;
+}
+
+/**
+ * @brief  Return a buffer to the pool
+ * @param  frame: Frame in any state
+ * @retval None
+ * @note   Safe to call from interrupt context
+ */
+void FramePool_Release(Frame_t *frame)
+{
+    if (frame != NULL) {
+        frame->state = FRAME_FREE;
+    }
+}
+
+/**
+ * @brief  Count buffers in a given state
+ * @param  state: State to count
+ * @retval Number of buffers
+ */
+uint32_t FramePool_Count(FrameState_t state)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < FRAME_POOL_COUNT; i++) {
+        if (frames[i].state == state) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief  Check for a free buffer large enough for a frame
+ * @param  minSize: Required capacity in bytes
+ * @retval true if FramePool_Acquire(minSize) would succeed
+ * @note   A snapshot: a buffer may still be released from interrupt
+ *         context right after the check.
+ */
+bool FramePool_HasFree(uint32_t minSize)
+{
+    for (uint32_t i = 0; i < FRAME_POOL_COUNT; i++) {
+        if (frames[i].state == FRAME_FREE && frames[i].size >= minSize) {
+            return true;
+        }
+    }
+
+    return false;
+}
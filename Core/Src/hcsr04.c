@@ -1,98 +1,510 @@
 /**
  ******************************************************************************
  * @file    hcsr04.c
- * @brief   HC-SR04 ultrasonic sensor driver using TIM3 Input Capture (Non-blocking)
+ * @brief   HC-SR04 ultrasonic sensor array driver using timer one-pulse
+ *          triggers and input capture (Non-blocking)
  * @author  Generated for STM32F407 Project
  *
- * @note    TIM3 configured as:
- *          - Prescaler: 84-1 -> 1MHz (1us resolution)
- *          - CH4 (PB1) configured as Input Capture
- *          - Trigger pin: PB0 (GPIO Output)
+ * @note    Each sensor (see HCSR04_Config_t):
+ *          - TRIG from a timer in one-pulse PWM2 mode, e.g. TIM1 CH2N (PB0)
+ *            at 1MHz with CCR = 1, ARR = 12 -> 12us pulse
+ *          - ECHO into a 1MHz timer channel capturing both edges, each
+ *            capture moved by DMA into an edge buffer (no IRQ), e.g.
+ *            TIM3 CH4 (PB1) on DMA1 Stream2 Channel 5.
+ *            The echo timer is started by TIM2 (slave trigger mode), so its
+ *            captures extend onto the 32-bit clock (see timebase.c).
+ *          TIM2 is the array timebase (32-bit, 1us):
+ *          - CH1 Output Compare (timing), closes the echo window (IRQ)
+ *          - CH2 Output Compare (timing), starts the next slot (IRQ)
+ *
+ *          Sensors are grouped into slots so that no two sensors with
+ *          overlapping beams share a slot. All sensors of a slot fire
+ *          together, slots follow each other every HCSR04_CYCLE_US.
+ *          When the window closes, the edge train is split into echo
+ *          pulses; the first one gives the range, all are kept for
+ *          multipath analysis (HCSR04_GetEchoes).
  ******************************************************************************
  */
 
 #include "hcsr04.h"
 #include "tim.h"
 #include "main.h"
+#include "timebase.h"
+#include "ring_buffer.h"
+#include <string.h>
+
+#if (HCSR04_RING_SIZE & (HCSR04_RING_SIZE - 1U)) != 0U
+#error "HCSR04_RING_SIZE must be a power of two"
+#endif
+
+/* Array timebase: window and slot compares */
+#define HCSR04_TIMEBASE         (&htim2)
+#define HCSR04_WINDOW_CHANNEL   TIM_CHANNEL_1
+#define HCSR04_SLOT_CHANNEL     TIM_CHANNEL_2
+
+/* Per-sensor state */
+typedef struct {
+    const HCSR04_Config_t *config;
+    volatile HCSR04_Status_t status;
+    volatile uint16_t distance_mm;
+    uint32_t fireTime_us;           // Timebase when the trigger was fired
+
+    /* Edge train of the open window, written by DMA */
+    uint16_t edges[HCSR04_MAX_EDGES];
+    HCSR04_Echo_t echoes[HCSR04_MAX_ECHOES];   // Pulses of the last window
+    volatile uint8_t echoCount;
+
+    /* Raw sample ring: window ISR produces, application consumes */
+    HCSR04_Sample_t ringStorage[HCSR04_RING_SIZE];
+    Ring_t ring;
+
+    /* Filter state is owned by the ISRs; readers only see filteredEcho_us */
+    HCSR04_Filter_t filter;
+    volatile uint32_t filteredEcho_us;  // 0 while no estimate
+    volatile bool filterResetPending;
+} HCSR04_Sensor_t;
 
 /* Private variables */
-static volatile uint32_t capture1 = 0;
-static volatile uint32_t capture2 = 0;
-static volatile uint8_t captureFlag = 0;
-static volatile HCSR04_Status_t measureStatus = HCSR04_IDLE;
-static volatile float distance_cm = 0.0f;
-static volatile uint32_t timeoutCounter = 0;
+static HCSR04_Sensor_t sensors[HCSR04_MAX_SENSORS];
+static uint8_t sensorCount = 0;
+static HCSR04_Callback_t doneCallback = NULL;
+static volatile uint32_t soundFactorQ16 = 0;   // mm per us of echo, Q16
+
+/* Scheduler */
+static uint8_t slotMask[HCSR04_MAX_SENSORS];
+static uint8_t slotCount = 0;
+static uint8_t slotNext = 0;
+static volatile bool continuousMode = false;
+static volatile uint8_t activeMask = 0;     // Sensors inside the open echo window
 
-/* Timeout threshold (software timeout counter, not TIM3 ticks)
- * ~100ms timeout = 100000 iterations in typical polling loop
+/**
+ * @brief  Capture/compare flag of a timer channel
+ * @param  channel: TIM_CHANNEL_1..TIM_CHANNEL_4
+ * @retval TIM_FLAG_CCx
  */
-#define HCSR04_SW_TIMEOUT  100000UL
+static inline uint32_t HCSR04_ChannelFlag(uint32_t channel)
+{
+    return TIM_FLAG_CC1 << (channel >> 2);
+}
 
 /**
- * @brief  Initialize HC-SR04 sensor
- * @param  None
+ * @brief  Over-capture flag of a timer channel
+ * @param  channel: TIM_CHANNEL_1..TIM_CHANNEL_4
+ * @retval TIM_FLAG_CCxOF
+ */
+static inline uint32_t HCSR04_OvercaptureFlag(uint32_t channel)
+{
+    return TIM_FLAG_CC1OF << (channel >> 2);
+}
+
+/**
+ * @brief  Arm the edge DMA of a sensor's echo channel
+ * @param  sensor: Sensor state
+ * @retval None
+ * @note   The channel keeps capturing between windows; only the DMA
+ *         request is switched, so the slaved counter is never stopped.
+ */
+static void HCSR04_StartEdges(HCSR04_Sensor_t *sensor)
+{
+    const HCSR04_Config_t *config = sensor->config;
+    TIM_HandleTypeDef *htim = config->echoTim;
+    uint32_t index = config->echoChannel >> 2;
+    volatile uint32_t *ccr = &htim->Instance->CCR1 + index;
+    DMA_HandleTypeDef *hdma = htim->hdma[TIM_DMA_ID_CC1 + index];
+
+    /* Re-triggered before its window closed */
+    if (hdma->State == HAL_DMA_STATE_BUSY) {
+        __HAL_TIM_DISABLE_DMA(htim, TIM_DMA_CC1 << index);
+        HAL_DMA_Abort(hdma);
+    }
+
+    /* Reading the capture register discards an edge latched since the last window */
+    (void)*ccr;
+    __HAL_TIM_CLEAR_FLAG(htim, HCSR04_OvercaptureFlag(config->echoChannel));
+
+    HAL_DMA_Start(hdma, (uint32_t)ccr, (uint32_t)sensor->edges, HCSR04_MAX_EDGES);
+    __HAL_TIM_ENABLE_DMA(htim, TIM_DMA_CC1 << index);
+}
+
+/**
+ * @brief  Disarm the edge DMA of a sensor's echo channel
+ * @param  sensor: Sensor state
+ * @retval Number of edges written to sensor->edges
+ */
+static uint8_t HCSR04_StopEdges(HCSR04_Sensor_t *sensor)
+{
+    const HCSR04_Config_t *config = sensor->config;
+    TIM_HandleTypeDef *htim = config->echoTim;
+    uint32_t index = config->echoChannel >> 2;
+    DMA_HandleTypeDef *hdma = htim->hdma[TIM_DMA_ID_CC1 + index];
+
+    __HAL_TIM_DISABLE_DMA(htim, TIM_DMA_CC1 << index);
+    HAL_DMA_Abort(hdma);
+
+    return (uint8_t)(HCSR04_MAX_EDGES - __HAL_DMA_GET_COUNTER(hdma));
+}
+
+/**
+ * @brief  HAL active channel code of a timer channel
+ * @param  channel: TIM_CHANNEL_1..TIM_CHANNEL_4
+ * @retval HAL_TIM_ACTIVE_CHANNEL_x
+ */
+static inline HAL_TIM_ActiveChannel HCSR04_ActiveChannel(uint32_t channel)
+{
+    return (HAL_TIM_ActiveChannel)(1U << (channel >> 2));
+}
+
+/**
+ * @brief  Finish a measurement, record it and notify the listener
+ * @param  id: Sensor index
+ * @param  status: HCSR04_READY or HCSR04_TIMEOUT
+ * @param  echo_us: Echo width in microseconds (ignored on timeout)
+ * @param  timestamp_us: Timebase of the echo start (window end on timeout)
+ * @retval None
+ * @note   Called from timer interrupt context
+ */
+static void HCSR04_Complete(uint8_t id, HCSR04_Status_t status, uint32_t echo_us,
+                            uint32_t timestamp_us)
+{
+    HCSR04_Sensor_t *sensor = &sensors[id];
+    HCSR04_Sample_t sample;
+    sample.timestamp_us = timestamp_us;
+    sample.valid = (status == HCSR04_READY);
+    sample.echo_us = sample.valid ? (uint16_t)echo_us : 0U;
+    sample.distance_mm = sample.valid
+                       ? (uint16_t)HCSR04_PulseToMillimetres(echo_us, soundFactorQ16) : 0U;
+    sensor->distance_mm = sample.distance_mm;
+
+    /* Push the raw sample, dropping it if the reader fell behind */
+    Ring_Push(&sensor->ring, &sample);
+
+    if (sensor->filterResetPending) {
+        sensor->filterResetPending = false;
+        HCSR04_FilterReset(&sensor->filter);
+    }
+    sensor->filteredEcho_us = HCSR04_FilterUpdate(&sensor->filter, &sample)
+                            ? ((sensor->filter.ema_q4 + 8U) >> 4) : 0U;
+
+    activeMask &= (uint8_t)~(1U << id);
+    sensor->status = status;
+    if (doneCallback != NULL) {
+        doneCallback(id, status);
+    }
+}
+
+/**
+ * @brief  Fire a set of sensors together and open the echo window
+ * @param  mask: Bitmask of sensor indices
  * @retval None
  */
-void HCSR04_Init(void)
+static void HCSR04_Fire(uint8_t mask)
 {
-    /* Ensure TRIG pin is LOW */
-    HAL_GPIO_WritePin(HCSR04_TRIG_PORT, HCSR04_TRIG_PIN, GPIO_PIN_RESET);
+    uint32_t now = Timebase_Now();
+
+    for (uint8_t id = 0; id < sensorCount; id++) {
+        if ((mask & (1U << id)) == 0U) {
+            continue;
+        }
+        const HCSR04_Config_t *config = sensors[id].config;
 
-    /* Start Input Capture with interrupt */
-    HAL_TIM_IC_Start_IT(&htim3, TIM_CHANNEL_4);
+        HCSR04_StartEdges(&sensors[id]);
+        sensors[id].status = HCSR04_MEASURING;
+        sensors[id].fireTime_us = now;
 
-    measureStatus = HCSR04_IDLE;
+        /* Start the one-pulse timer: hardware emits the pulse and stops */
+        __HAL_TIM_ENABLE(config->trigTim);
+    }
+
+    /* Echo window from now on the free-running timebase */
+    __HAL_TIM_SET_COMPARE(HCSR04_TIMEBASE, HCSR04_WINDOW_CHANNEL, now + HCSR04_ECHO_WINDOW_US);
+    __HAL_TIM_CLEAR_FLAG(HCSR04_TIMEBASE, HCSR04_ChannelFlag(HCSR04_WINDOW_CHANNEL));
+    activeMask |= mask;
 }
 
 /**
- * @brief  Trigger a distance measurement
+ * @brief  Initialize the sensor array
+ * @param  configs: Wiring of each sensor, must stay valid (static const)
+ * @param  count: Number of sensors, 1..HCSR04_MAX_SENSORS
+ * @retval HCSR04_OK or HCSR04_ERROR on a bad count, a missing echo DMA
+ *         or a timer start failure
+ */
+HCSR04_Result_t HCSR04_Init(const HCSR04_Config_t *configs, uint8_t count)
+{
+    if (count == 0U || count > HCSR04_MAX_SENSORS) {
+        return HCSR04_ERROR;
+    }
+
+    continuousMode = false;
+    activeMask = 0;
+    sensorCount = count;
+    HCSR04_SetTemperature(HCSR04_DEFAULT_TEMP_DC);
+
+    uint8_t overlap[HCSR04_MAX_SENSORS];
+    for (uint8_t id = 0; id < count; id++) {
+        const HCSR04_Config_t *config = &configs[id];
+        HCSR04_Sensor_t *sensor = &sensors[id];
+
+        memset(sensor, 0, sizeof(*sensor));
+        Ring_Init(&sensor->ring, sensor->ringStorage, sizeof(HCSR04_Sample_t), HCSR04_RING_SIZE);
+        sensor->config = config;
+        sensor->status = HCSR04_IDLE;
+        overlap[id] = config->overlap;
+
+        /* Connect the pulse output; the counter stays stopped until a trigger */
+        HAL_StatusTypeDef hal = config->trigComplementary
+                              ? HAL_TIMEx_OnePulseN_Start(config->trigTim, config->trigChannel)
+                              : HAL_TIM_OnePulse_Start(config->trigTim, config->trigChannel);
+        if (hal != HAL_OK) {
+            return HCSR04_ERROR;
+        }
+
+        /* The echo channel latches every edge; DMA collects them while a
+         * window is open, so there is no capture interrupt at all */
+        if (config->echoTim->hdma[TIM_DMA_ID_CC1 + (config->echoChannel >> 2)] == NULL ||
+            HAL_TIM_IC_Start(config->echoTim, config->echoChannel) != HAL_OK) {
+            return HCSR04_ERROR;
+        }
+    }
+
+    slotCount = HCSR04_BuildSchedule(overlap, count, slotMask);
+    slotNext = 0;
+
+    /* Window and slot compares on the free-running timebase */
+    if (HAL_TIM_OC_Start_IT(HCSR04_TIMEBASE, HCSR04_WINDOW_CHANNEL) != HAL_OK ||
+        HAL_TIM_OC_Start_IT(HCSR04_TIMEBASE, HCSR04_SLOT_CHANNEL) != HAL_OK) {
+        return HCSR04_ERROR;
+    }
+
+    return HCSR04_OK;
+}
+
+/**
+ * @brief  Number of configured sensors
  * @param  None
+ * @retval Sensor count
+ */
+uint8_t HCSR04_GetCount(void)
+{
+    return sensorCount;
+}
+
+/**
+ * @brief  Trigger a single distance measurement
+ * @param  id: Sensor index
  * @retval None
  * @note   Non-blocking, result available via HCSR04_GetStatus() and HCSR04_GetDistance()
+ *         The pulse is generated by a timer in one-pulse mode, so its width
+ *         does not depend on compiler flags or flash wait states.
+ *         Does not check for crosstalk; use continuous mode for that.
  */
-void HCSR04_Trigger(void)
+void HCSR04_Trigger(uint8_t id)
 {
-    /* Reset state */
-    captureFlag = 0;
-    measureStatus = HCSR04_MEASURING;
-    timeoutCounter = 0;
+    if (id >= sensorCount) {
+        return;
+    }
 
-    /* Send 10us trigger pulse */
-    HAL_GPIO_WritePin(HCSR04_TRIG_PORT, HCSR04_TRIG_PIN, GPIO_PIN_SET);
+    HCSR04_Fire((uint8_t)(1U << id));
+}
 
-    /* Delay 10us (using basic loop, more accurate than HAL_Delay) */
-    for (volatile uint32_t i = 0; i < 168; i++); // ~10us at 168MHz
+/**
+ * @brief  Register a completion listener
+ * @param  callback: Called from interrupt context with the sensor index and
+ *                   HCSR04_READY or HCSR04_TIMEOUT, or NULL to disable
+ * @retval None
+ */
+void HCSR04_SetCallback(HCSR04_Callback_t callback)
+{
+    doneCallback = callback;
+}
+
+/**
+ * @brief  Start free-running ranging of all sensors
+ * @param  None
+ * @retval None
+ * @note   One slot fires every HCSR04_CYCLE_US. Each result is pushed into
+ *         the sensor's sample ring and filter; read them with
+ *         HCSR04_ReadSample() and HCSR04_GetFilteredDistance().
+ */
+void HCSR04_StartContinuous(void)
+{
+    __HAL_TIM_SET_COMPARE(HCSR04_TIMEBASE, HCSR04_SLOT_CHANNEL, Timebase_Now() + HCSR04_CYCLE_US);
+    __HAL_TIM_CLEAR_FLAG(HCSR04_TIMEBASE, HCSR04_ChannelFlag(HCSR04_SLOT_CHANNEL));
+    continuousMode = true;
 
-    HAL_GPIO_WritePin(HCSR04_TRIG_PORT, HCSR04_TRIG_PIN, GPIO_PIN_RESET);
+    HCSR04_Fire(slotMask[0]);
+    slotNext = (slotCount > 1U) ? 1U : 0U;
 }
 
 /**
- * @brief  Get current measurement status
+ * @brief  Stop free-running ranging after the measurements in flight
+ * @param  None
+ * @retval None
+ */
+void HCSR04_StopContinuous(void)
+{
+    continuousMode = false;
+}
+
+/**
+ * @brief  Number of scheduler slots, i.e. continuous cycles per full sweep
  * @param  None
+ * @retval Slot count
+ */
+uint8_t HCSR04_GetSlotCount(void)
+{
+    return slotCount;
+}
+
+/**
+ * @brief  Pop the oldest raw sample of a sensor
+ * @param  id: Sensor index
+ * @param  sample: Destination
+ * @retval true if a sample was returned, false if the ring is empty
+ * @note   Single consumer per sensor
+ */
+bool HCSR04_ReadSample(uint8_t id, HCSR04_Sample_t *sample)
+{
+    if (id >= sensorCount) {
+        return false;
+    }
+
+    return Ring_Pop(&sensors[id].ring, sample);
+}
+
+/**
+ * @brief  Number of samples lost because the ring was full
+ * @param  id: Sensor index
+ * @retval Dropped sample count since init
+ */
+uint32_t HCSR04_GetDroppedSamples(uint8_t id)
+{
+    return (id < sensorCount) ? sensors[id].ring.dropped : 0U;
+}
+
+/**
+ * @brief  Latest filtered distance, available without waiting
+ * @param  id: Sensor index
+ * @param  distance_cm: Receives the distance in centimeters
+ * @retval true if an estimate is available, false if there is none (no
+ *         echo yet since the last reset, or HCSR04_MAX_MISSES timeouts)
+ */
+bool HCSR04_GetFilteredDistance(uint8_t id, float *distance_cm)
+{
+    uint16_t mm;
+
+    if (!HCSR04_GetFilteredDistanceMm(id, &mm)) {
+        return false;
+    }
+
+    *distance_cm = mm / 10.0f;
+    return true;
+}
+
+/**
+ * @brief  Latest filtered distance in millimetres, integer only
+ * @param  id: Sensor index
+ * @param  distance_mm: Receives the temperature-compensated distance
+ * @retval true if an estimate is available (see HCSR04_GetFilteredDistance)
+ */
+bool HCSR04_GetFilteredDistanceMm(uint8_t id, uint16_t *distance_mm)
+{
+    if (id >= sensorCount) {
+        return false;
+    }
+
+    uint32_t echo = sensors[id].filteredEcho_us;
+    if (echo == 0U) {
+        return false;
+    }
+
+    *distance_mm = (uint16_t)HCSR04_PulseToMillimetres(echo, soundFactorQ16);
+    return true;
+}
+
+/**
+ * @brief  Update the speed of sound from the ambient temperature
+ * @param  temp_dC: Air temperature in 0.1 degC, clamped to -40.0..+85.0
+ * @retval None
+ * @note   Takes effect for the next echo and for filtered reads.
+ */
+void HCSR04_SetTemperature(int16_t temp_dC)
+{
+    soundFactorQ16 = HCSR04_SoundFactorQ16(temp_dC);
+}
+
+/**
+ * @brief  Forget the filtered estimate, e.g. after the sensor was moved
+ * @param  id: Sensor index
+ * @retval None
+ * @note   The filter belongs to the ISR, so the reset is applied there
+ *         before the next sample is folded in.
+ */
+void HCSR04_ResetFilter(uint8_t id)
+{
+    if (id >= sensorCount) {
+        return;
+    }
+
+    sensors[id].filteredEcho_us = 0;
+    sensors[id].filterResetPending = true;
+}
+
+/**
+ * @brief  Get current measurement status
+ * @param  id: Sensor index
  * @retval HCSR04_Status_t
+ * @note   A measurement always ends within HCSR04_ECHO_WINDOW_US, the
+ *         timeout is enforced by the timebase window compare, not by polling.
  */
-HCSR04_Status_t HCSR04_GetStatus(void)
+HCSR04_Status_t HCSR04_GetStatus(uint8_t id)
 {
-    /* Check for timeout */
-    if (measureStatus == HCSR04_MEASURING) {
-        timeoutCounter++;
-        if (timeoutCounter > HCSR04_SW_TIMEOUT) {
-            measureStatus = HCSR04_TIMEOUT;
-            distance_cm = 0.0f;
-        }
+    return (id < sensorCount) ? sensors[id].status : HCSR04_IDLE;
+}
+
+/**
+ * @brief  Echo pulses of the last closed window
+ * @param  id: Sensor index
+ * @param  echoes: Destination, in arrival order (nearest reflector first)
+ * @param  max: Capacity of echoes, up to HCSR04_MAX_ECHOES are available
+ * @retval Number of echoes copied, 0 after a timeout
+ */
+uint8_t HCSR04_GetEchoes(uint8_t id, HCSR04_Echo_t *echoes, uint8_t max)
+{
+    if (id >= sensorCount) {
+        return 0;
     }
 
-    return measureStatus;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint8_t count = sensors[id].echoCount;
+    if (count > max) {
+        count = max;
+    }
+    memcpy(echoes, sensors[id].echoes, count * sizeof(HCSR04_Echo_t));
+
+    __set_PRIMASK(primask);
+    return count;
 }
 
 /**
  * @brief  Get measured distance (only valid when status is HCSR04_READY)
- * @param  None
+ * @param  id: Sensor index
  * @retval Distance in centimeters
  */
-float HCSR04_GetDistance(void)
+float HCSR04_GetDistance(uint8_t id)
 {
-    return distance_cm;
+    return HCSR04_GetDistanceMm(id) / 10.0f;
+}
+
+/**
+ * @brief  Get measured distance in millimetres (only valid when status is HCSR04_READY)
+ * @param  id: Sensor index
+ * @retval Temperature-compensated distance in millimetres
+ */
+uint16_t HCSR04_GetDistanceMm(uint8_t id)
+{
+    return (id < sensorCount) ? sensors[id].distance_mm : 0U;
 }
 
 /**
@@ -101,49 +513,273 @@ float HCSR04_GetDistance(void)
  * @retval Distance in centimeters
  * @note   Speed of sound = 340 m/s = 0.034 cm/us
  *         Distance = (Time * 0.034) / 2 = Time * 0.017
+ *         Float reference for HCSR04_PulseToMillimetres(), not used at runtime.
  */
 float HCSR04_PulseToDistance(uint32_t pulseWidth_us)
 {
     return pulseWidth_us * 0.017f;
 }
 
+/* Round-trip reciprocal pace, i.e. mm of range per us of echo in Q16:
+ * 65536 * 331.3 * sqrt(1 + T / 273.15) / 2000, T = -40..+85 degC step 5 */
+#define SOUND_TABLE_MIN_DC      (-400)
+#define SOUND_TABLE_STEP_DC     50
+#define SOUND_TABLE_LEN         26U
+
+static const uint16_t soundFactorTable[SOUND_TABLE_LEN] = {
+    10030, 10137, 10243, 10347, 10451, 10554,
+    10655, 10756, 10856, 10955, 11053, 11150,
+    11246, 11342, 11437, 11531, 11624, 11716,
+    11808, 11899, 11989, 12079, 12168, 12256,
+    12344, 12431,
+};
+
+/**
+ * @brief  Speed-of-sound factor for a temperature (pure calculation for testing)
+ * @param  temp_dC: Air temperature in 0.1 degC, clamped to -40.0..+85.0
+ * @retval mm of range per us of echo, Q16
+ * @note   Linear interpolation between the 5 degC table points; the error
+ *         against the square-root law stays below 0.01%.
+ */
+uint32_t HCSR04_SoundFactorQ16(int16_t temp_dC)
+{
+    int32_t offset = (int32_t)temp_dC - SOUND_TABLE_MIN_DC;
+    int32_t last = (int32_t)(SOUND_TABLE_LEN - 1U) * SOUND_TABLE_STEP_DC;
+
+    if (offset <= 0) {
+        return soundFactorTable[0];
+    }
+    if (offset >= last) {
+        return soundFactorTable[SOUND_TABLE_LEN - 1U];
+    }
+
+    uint32_t index = (uint32_t)offset / SOUND_TABLE_STEP_DC;
+    uint32_t frac = (uint32_t)offset % SOUND_TABLE_STEP_DC;
+    uint32_t lo = soundFactorTable[index];
+    uint32_t hi = soundFactorTable[index + 1U];
+
+    return lo + ((hi - lo) * frac + SOUND_TABLE_STEP_DC / 2U) / SOUND_TABLE_STEP_DC;
+}
+
 /**
- * @brief  Input Capture callback handler
- * @param  None
+ * @brief  Convert echo width to distance, integer only (pure calculation for testing)
+ * @param  echo_us: Echo width in microseconds
+ * @param  factor_q16: Value from HCSR04_SoundFactorQ16()
+ * @retval Distance in millimetres, rounded
+ */
+uint32_t HCSR04_PulseToMillimetres(uint32_t echo_us, uint32_t factor_q16)
+{
+    return (echo_us * factor_q16 + 0x8000U) >> 16;
+}
+
+/**
+ * @brief  Split a captured edge train into echo pulses (pure calculation for testing)
+ * @param  edges: 16-bit captures in arrival order, starting with a rising edge
+ * @param  count: Number of captures
+ * @param  now: Timebase read after the last capture (less than 65.5 ms later)
+ * @param  echoes: Receives up to count / 2 echoes
+ * @retval Number of echoes stored
+ * @note   Pulses shorter than HCSR04_MIN_ECHO_US are dropped as glitches. A
+ *         trailing rising edge (echo still high when the window closed) is
+ *         ignored.
+ */
+uint8_t HCSR04_ExtractEchoes(const uint16_t *edges, uint8_t count, uint32_t now,
+                             HCSR04_Echo_t *echoes)
+{
+    uint8_t found = 0;
+
+    for (uint8_t i = 0; i + 1U < count; i += 2U) {
+        uint32_t rise = Timebase_Extend(now, edges[i]);
+        uint32_t width = Timebase_Extend(now, edges[i + 1U]) - rise;
+
+        if (width < HCSR04_MIN_ECHO_US) {
+            continue;
+        }
+        echoes[found].start_us = rise;
+        echoes[found].width_us = (uint16_t)width;
+        found++;
+    }
+
+    return found;
+}
+
+/**
+ * @brief  Median of a short list of echo widths (pure calculation for testing)
+ * @param  values: Echo widths in microseconds, left unmodified
+ * @param  count: Number of values, 1..HCSR04_MEDIAN_LEN
+ * @retval Median value; mean of the two middle values for an even count
+ */
+uint16_t HCSR04_Median(const uint16_t *values, uint8_t count)
+{
+    uint16_t sorted[HCSR04_MEDIAN_LEN];
+
+    if (count == 0U) {
+        return 0U;
+    }
+    if (count > HCSR04_MEDIAN_LEN) {
+        count = HCSR04_MEDIAN_LEN;
+    }
+
+    /* Insertion sort, at most HCSR04_MEDIAN_LEN entries */
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t v = values[i];
+        uint8_t j = i;
+        while (j > 0U && sorted[j - 1U] > v) {
+            sorted[j] = sorted[j - 1U];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    if ((count & 1U) != 0U) {
+        return sorted[count / 2U];
+    }
+    return (uint16_t)(((uint32_t)sorted[count / 2U - 1U] + sorted[count / 2U] + 1U) / 2U);
+}
+
+/**
+ * @brief  Clear a distance filter
+ * @param  filter: Filter state
  * @retval None
- * @note   This should be called from HAL_TIM_IC_CaptureCallback in stm32f4xx_it.c
  */
-void HCSR04_CaptureCallback(void)
+void HCSR04_FilterReset(HCSR04_Filter_t *filter)
 {
-    if (captureFlag == 0) {
-        /* First edge (rising) - start of echo pulse */
-        capture1 = HAL_TIM_ReadCapturedValue(&htim3, TIM_CHANNEL_4);
-        captureFlag = 1;
+    memset(filter, 0, sizeof(*filter));
+}
 
-        /* Change polarity to falling edge */
-        __HAL_TIM_SET_CAPTUREPOLARITY(&htim3, TIM_CHANNEL_4, TIM_INPUTCHANNELPOLARITY_FALLING);
+/**
+ * @brief  Fold one raw sample into the filter (pure calculation for testing)
+ * @param  filter: Filter state
+ * @param  sample: Raw sample
+ * @retval true if the filter holds a valid estimate afterwards
+ * @note   Valid echoes go through a median-of-HCSR04_MEDIAN_LEN window, so a
+ *         single outlier never reaches the EMA. Isolated timeouts are
+ *         ignored; HCSR04_MAX_MISSES in a row clear the estimate.
+ */
+bool HCSR04_FilterUpdate(HCSR04_Filter_t *filter, const HCSR04_Sample_t *sample)
+{
+    if (!sample->valid) {
+        if (filter->misses < UINT8_MAX) {
+            filter->misses++;
+        }
+        if (filter->misses >= HCSR04_MAX_MISSES) {
+            HCSR04_FilterReset(filter);
+        }
+        return filter->valid;
     }
-    else if (captureFlag == 1) {
-        /* Second edge (falling) - end of echo pulse */
-        capture2 = HAL_TIM_ReadCapturedValue(&htim3, TIM_CHANNEL_4);
 
-        /* Calculate pulse duration (in microseconds) */
-        uint32_t pulseWidth;
-        if (capture2 >= capture1) {
-            pulseWidth = capture2 - capture1;
-        } else {
-            /* Timer overflow occurred */
-            pulseWidth = (0xFFFF - capture1) + capture2;
+    filter->misses = 0;
+    filter->window[filter->next] = sample->echo_us;
+    filter->next = (uint8_t)((filter->next + 1U) % HCSR04_MEDIAN_LEN);
+    if (filter->count < HCSR04_MEDIAN_LEN) {
+        filter->count++;
+    }
+
+    uint32_t median_q4 = (uint32_t)HCSR04_Median(filter->window, filter->count) << 4;
+    if (!filter->valid) {
+        filter->ema_q4 = median_q4;
+        filter->valid = true;
+    } else if (median_q4 >= filter->ema_q4) {
+        filter->ema_q4 += (median_q4 - filter->ema_q4) >> HCSR04_EMA_SHIFT;
+    } else {
+        filter->ema_q4 -= (filter->ema_q4 - median_q4) >> HCSR04_EMA_SHIFT;
+    }
+
+    return true;
+}
+
+/**
+ * @brief  Group sensors into firing slots (pure calculation for testing)
+ * @param  overlap: Per sensor, bitmask of sensors whose beams overlap it;
+ *                  treated as symmetric
+ * @param  count: Number of sensors, 1..HCSR04_MAX_SENSORS
+ * @param  slots: Receives one sensor bitmask per slot
+ * @retval Number of slots used
+ * @note   Greedy colouring in sensor order: each sensor joins the first slot
+ *         holding no sensor it overlaps with. Sensors with disjoint beams
+ *         share a slot, so the aggregate rate grows with the sensor count.
+ */
+uint8_t HCSR04_BuildSchedule(const uint8_t *overlap, uint8_t count, uint8_t *slots)
+{
+    uint8_t conflict[HCSR04_MAX_SENSORS];
+    uint8_t used = 0;
+
+    if (count > HCSR04_MAX_SENSORS) {
+        count = HCSR04_MAX_SENSORS;
+    }
+
+    /* Make the overlap relation symmetric and ignore self-overlap */
+    for (uint8_t i = 0; i < count; i++) {
+        conflict[i] = (uint8_t)(overlap[i] & ~(1U << i));
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t j = 0; j < count; j++) {
+            if ((conflict[i] & (1U << j)) != 0U) {
+                conflict[j] |= (uint8_t)(1U << i);
+            }
         }
+    }
 
-        /* Convert to distance using the pure calculation function */
-        distance_cm = HCSR04_PulseToDistance(pulseWidth);
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t s = 0;
+        while (s < used && (slots[s] & conflict[i]) != 0U) {
+            s++;
+        }
+        if (s == used) {
+            slots[used++] = 0;
+        }
+        slots[s] |= (uint8_t)(1U << i);
+    }
+
+    return used;
+}
+
+/**
+ * @brief  Timebase compare handler (echo window and scheduler slots)
+ * @param  htim: Timer that raised the compare
+ * @retval None
+ * @note   This should be called from HAL_TIM_OC_DelayElapsedCallback.
+ *         The timebase free-runs, so both compares also match once per
+ *         wrap (~71 min) while idle; only open windows and continuous
+ *         mode react.
+ */
+void HCSR04_CompareCallback(TIM_HandleTypeDef *htim)
+{
+    if (htim != HCSR04_TIMEBASE) {
+        return;
+    }
+
+    if (htim->Channel == HCSR04_ActiveChannel(HCSR04_WINDOW_CHANNEL)) {
+        /* Window closed: split each edge train into echoes, the first one
+         * is the nearest reflector; no echo at all means out of range */
+        uint8_t pending = activeMask;
+        uint32_t now = Timebase_Now();
+        for (uint8_t id = 0; id < sensorCount; id++) {
+            HCSR04_Sensor_t *sensor = &sensors[id];
+            if ((pending & (1U << id)) == 0U || sensor->status != HCSR04_MEASURING) {
+                continue;
+            }
+
+            uint8_t edges = HCSR04_StopEdges(sensor);
+            sensor->echoCount = HCSR04_ExtractEchoes(sensor->edges, edges, now, sensor->echoes);
+            if (sensor->echoCount > 0U) {
+                HCSR04_Complete(id, HCSR04_READY, sensor->echoes[0].width_us,
+                                sensor->echoes[0].start_us);
+            } else {
+                HCSR04_Complete(id, HCSR04_TIMEOUT, 0, sensor->fireTime_us + HCSR04_ECHO_WINDOW_US);
+            }
+        }
+        activeMask = 0;
+    } else if (htim->Channel == HCSR04_ActiveChannel(HCSR04_SLOT_CHANNEL)) {
+        if (!continuousMode) {
+            return;
+        }
 
-        /* Mark measurement complete */
-        measureStatus = HCSR04_READY;
-        captureFlag = 0;
+        /* Next slot exactly one cycle after the previous one */
+        uint32_t ccr = __HAL_TIM_GET_COMPARE(htim, HCSR04_SLOT_CHANNEL);
+        __HAL_TIM_SET_COMPARE(htim, HCSR04_SLOT_CHANNEL, ccr + HCSR04_CYCLE_US);
 
-        /* Reset polarity to rising edge for next measurement */
-        __HAL_TIM_SET_CAPTUREPOLARITY(&htim3, TIM_CHANNEL_4, TIM_INPUTCHANNELPOLARITY_RISING);
+        HCSR04_Fire(slotMask[slotNext]);
+        slotNext = (uint8_t)((slotNext + 1U) % slotCount);
     }
 }
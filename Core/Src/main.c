@@ -30,8 +30,16 @@
 #include <stdio.h>
 #include <string.h>
 #include "servo_driver.h"
+#include "servo_motion.h"
 #include "hcsr04.h"
 #include "ov2640.h"
+#include "serial_link.h"
+#include "frame_pool.h"
+#include "telemetry.h"
+#include "packet.h"
+#include "timebase.h"
+#include "scan_pipeline.h"
+#include "event_loop.h"
 
 #ifdef ENABLE_UNIT_TESTS
 #include "test_suite.h"
@@ -57,13 +65,34 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-/* Image buffer for OV2640 (aligned for DMA) */
-#define IMAGE_BUFFER_SIZE   (10 * 1024)  // 10KB buffer for JPEG
-__attribute__((aligned(4))) uint8_t imageBuffer[IMAGE_BUFFER_SIZE];
-
-/* Scan parameters */
+/* OV2640 init (frame buffers come from frame_pool.c) */
+#define CAMERA_INIT_TIMEOUT_MS  500      // Max wait for the SCCB register load
+
+/* JPEG size budget: what the UART can carry per scan stop. The image
+ * transfer is the slowest pipeline stage, so this sets the scan cycle. */
+#define SCAN_PERIOD_MS          800      // Target time per stop
+#define IMAGE_LINK_SHARE        75       // Percent of the link for image data
+
+/* Ultrasonic sensors. Add entries (up to HCSR04_MAX_SENSORS) for more
+ * sensors and mark beams that overlap so they never fire together. */
+#define RANGER_FORWARD          0U
+static const HCSR04_Config_t rangerConfig[] = {
+    /* Forward: TRIG PB0 (TIM1_CH2N), ECHO PB1 (TIM3 CH4 both edges, DMA1 Stream2) */
+    { &htim1, TIM_CHANNEL_2, true, &htim3, TIM_CHANNEL_4, 0x00U },
+};
+
+#ifdef SCAN_SWEEP
+/* Sweep position */
 float currentPanAngle = 0.0f;    // Current horizontal angle
 float currentTiltAngle = 90.0f;  // Current vertical angle (fixed)
+
+/* Continuous sweep: one range slot every 60 ms -> ~1.8 degrees apart */
+#define SWEEP_SPEED_DPS         30.0f
+
+static bool sweepRunning = false;   // false while moving to the start
+static float sweepTarget = 180.0f;
+static uint32_t sweepPoints = 0;
+#endif
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -75,6 +104,89 @@ void SystemClock_Config(void);
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
 
+/**
+  * @brief  HC-SR04 completion listener, hands the sample to the event loop
+  * @note   Called from timer interrupt context
+  */
+static void Ranger_Done(uint8_t id, HCSR04_Status_t status)
+{
+    (void)status;
+    Event_Post(EVENT_RANGE_DONE, id);
+}
+
+#ifdef SCAN_SWEEP
+/**
+  * @brief  Send the raw samples taken during the sweep
+  * @note   Each sample is tagged with the pan angle commanded at the moment
+  *         the pulse was reflected (halfway through the echo), looked up on
+  *         the logged trajectory.
+  */
+static void Sweep_Drain(void)
+{
+    HCSR04_Sample_t raw;
+
+    while (HCSR04_ReadSample(RANGER_FORWARD, &raw)) {
+        uint32_t reflect_us = raw.timestamp_us + raw.echo_us / 2U;
+        float pan;
+
+        if (!sweepRunning || !Motion_AngleAt(SERVO_PAN_CHANNEL, reflect_us, &pan)) {
+            continue;   // Ranged on the way to the start, or older than the log
+        }
+
+        Telemetry_Sample_t sample = {0};
+        sample.timestamp_ms = HAL_GetTick() - (Timebase_Now() - reflect_us) / 1000U;
+        sample.pan_cdeg = (int16_t)(pan * 100.0f);
+        sample.tilt_cdeg = (int16_t)(currentTiltAngle * 100.0f);
+        sample.distance_mm = raw.distance_mm;
+        sample.flags = raw.valid ? TELEMETRY_FLAG_RANGE_VALID : TELEMETRY_FLAG_RANGE_TIMEOUT;
+        Telemetry_Send(&sample);
+        sweepPoints++;
+    }
+}
+
+/**
+  * @brief  Sweep event handler: pan axis across 0-180 degrees while ranging
+  * @param  event: EVENT_RANGE_DONE or EVENT_SWEEP_ARRIVED
+  * @note   The servo moves at constant speed and is never stopped for a
+  *         reading; every sample is sent as it completes. At each end the
+  *         next sweep runs back. No camera frames are taken in this mode.
+  */
+static void Sweep_OnEvent(const Event_t *event)
+{
+    Sweep_Drain();
+
+    if (event->id != EVENT_SWEEP_ARRIVED) {
+        return;
+    }
+
+    if (sweepRunning) {
+        currentPanAngle = sweepTarget;
+        printf("\r\n--- Sweep to %u deg complete (%lu points) ---\r\n\r\n",
+               (unsigned int)sweepTarget, sweepPoints);
+    }
+
+    sweepTarget = (currentPanAngle < 90.0f) ? 180.0f : 0.0f;
+    sweepPoints = 0;
+    sweepRunning = true;
+    Motion_Sweep(SERVO_PAN_CHANNEL, sweepTarget, SWEEP_SPEED_DPS);
+    Event_StartTimer(EVENT_SWEEP_ARRIVED, Motion_GetWaitTime_ms(), 0);
+}
+
+/**
+  * @brief  Move to the sweep start; sweeping begins on arrival
+  */
+static void Sweep_Start(void)
+{
+    Event_Subscribe(EVENT_RANGE_DONE, Sweep_OnEvent);
+    Event_Subscribe(EVENT_SWEEP_ARRIVED, Sweep_OnEvent);
+
+    sweepRunning = false;
+    Motion_MoveTo(SERVO_PAN_CHANNEL, currentPanAngle);
+    Motion_MoveTo(SERVO_TILT_CHANNEL, currentTiltAngle);
+    Event_StartTimer(EVENT_SWEEP_ARRIVED, Motion_GetWaitTime_ms(), 0);
+}
+#endif /* SCAN_SWEEP */
+
 /* USER CODE END 0 */
 
 /**
@@ -109,6 +221,8 @@ int main(void)
   MX_DMA_Init();
   MX_DCMI_Init();
   MX_I2C2_Init();
+  MX_TIM1_Init();
+  MX_TIM2_Init();
   MX_TIM3_Init();
   MX_TIM4_Init();
   MX_USART1_UART_Init();
@@ -118,6 +232,11 @@ int main(void)
    * Application Initialization
    * ======================================== */
 
+  /* Start the shared microsecond clock first, everything is stamped from it */
+  Timebase_Init();
+  Event_Init();
+  SerialLink_StartReceive();
+
   printf("\r\n");
   printf("========================================\r\n");
   printf(" STM32F407 Smart Gimbal System\r\n");
@@ -129,27 +248,52 @@ int main(void)
   Run_All_Tests();
 #endif
 
-  /* 1. Initialize Servo Motors */
+  /* 1. Start OV2640 Camera init: reset and ID check, then the register
+   *    tables load over SCCB interrupts while the other drivers start up
+   */
+  FramePool_Init();
+  printf("[INIT] Initializing OV2640 camera...\r\n");
+  OV2640_Status_t camStatus = OV2640_InitAsync(OV2640_FORMAT_JPEG_QQVGA);
+
+  /* 2. Initialize Servo Motors */
   printf("[INIT] Initializing servos...\r\n");
   Servo_Init();
+  Motion_Init();
   printf("[OK] Servos initialized\r\n");
 
-  /* 2. Initialize HC-SR04 Ultrasonic Sensor */
+  /* 3. Initialize HC-SR04 Ultrasonic Sensor */
   printf("[INIT] Initializing ultrasonic sensor...\r\n");
-  HCSR04_Init();
-  printf("[OK] Ultrasonic sensor initialized\r\n");
+  bool rangerReady = (HCSR04_Init(rangerConfig, sizeof(rangerConfig) / sizeof(rangerConfig[0])) == HCSR04_OK);
+  if (rangerReady) {
+      HCSR04_SetCallback(Ranger_Done);
+      HCSR04_StartContinuous();
+      printf("[OK] Ultrasonic sensors initialized (%u sensors, %u slots of %u ms)\r\n",
+             HCSR04_GetCount(), HCSR04_GetSlotCount(), HCSR04_CYCLE_US / 1000U);
+  } else {
+      printf("[ERROR] Ultrasonic sensor init failed\r\n");
+  }
 
-  /* 3. Initialize OV2640 Camera */
-  printf("[INIT] Initializing OV2640 camera...\r\n");
-  OV2640_Status_t camStatus = OV2640_Init(OV2640_FORMAT_JPEG_QQVGA);
+  /* 4. Finish OV2640 Camera init */
+  if (camStatus == OV2640_OK) {
+      camStatus = OV2640_WaitReady(CAMERA_INIT_TIMEOUT_MS);
+  }
   if (camStatus == OV2640_OK) {
-      printf("[OK] OV2640 initialized (JPEG QQVGA 160x120)\r\n");
+      printf("[OK] OV2640 initialized (JPEG QQVGA 160x120, ready at %lu ms)\r\n", HAL_GetTick());
+      OV2640_SetFrameBudget(OV2640_FrameBudget(huart1.Init.BaudRate, SCAN_PERIOD_MS, IMAGE_LINK_SHARE));
   } else {
       printf("[ERROR] OV2640 init failed (code: %d)\r\n", camStatus);
   }
 
   printf("\r\n[SYSTEM READY]\r\n\r\n");
 
+#ifdef SCAN_SWEEP
+  /* 5. Continuous sweep, ranging on the fly */
+  Sweep_Start();
+#else
+  /* 5. Stop-and-go scan: move, range + capture, transmit run as a pipeline */
+  ScanPipeline_Start(camStatus == OV2640_OK, rangerReady);
+#endif
+
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -161,83 +305,16 @@ int main(void)
     /* USER CODE BEGIN 3 */
 
     /* ========================================
-     * Main Scanning Loop
+     * Main Loop: run-to-completion event dispatch
      * ======================================== */
 
-    /* Step 1: Move gimbal to new position */
-    Servo_SetAngle(SERVO_PAN_CHANNEL, currentPanAngle);
-    Servo_SetAngle(SERVO_TILT_CHANNEL, currentTiltAngle);
-    HAL_Delay(300);  // Wait for servo to stabilize
-
-    /* Step 2: Trigger ultrasonic distance measurement */
-    HCSR04_Trigger();
-
-    /* Wait for measurement to complete (non-blocking check with micro-delays) */
-    uint32_t timeout = 0;
-    while (HCSR04_GetStatus() == HCSR04_MEASURING && timeout < 10000) {
-        timeout++;
-        /* Add small delay to reduce CPU load during polling (10us per iteration) */
-        for (volatile uint32_t i = 0; i < 168; i++);  // ~10us at 168MHz
-    }
-
-    /* Step 3: Read distance */
-    float distance = 0.0f;
-    if (HCSR04_GetStatus() == HCSR04_READY) {
-        distance = HCSR04_GetDistance();
-    }
-
-    /* Step 4: Print telemetry data */
-    printf("Pan: %.1f deg | Tilt: %.1f deg | Distance: %.1f cm\r\n",
-           currentPanAngle, currentTiltAngle, distance);
-
-    /* Step 5: (Optional) Trigger camera capture and transmit image data */
-
-    if (camStatus == OV2640_OK) {
-        memset(imageBuffer, 0, IMAGE_BUFFER_SIZE);
-        if (OV2640_StartCapture(imageBuffer, IMAGE_BUFFER_SIZE) == OV2640_OK) {
-            HAL_Delay(100);  // Wait for capture (TODO: replace with callback)
-            OV2640_StopCapture();
-
-            printf("  [Camera] Image captured\r\n");
-
-            /* Transmit JPEG image data over UART */
-            printf("IMG_START\r\n");
-
-            /* Find actual JPEG size by looking for JPEG end marker (0xFF 0xD9) */
-            uint32_t jpegSize = 0;
-            for (uint32_t i = 0; i < IMAGE_BUFFER_SIZE - 1; i++) {
-                if (imageBuffer[i] == 0xFF && imageBuffer[i+1] == 0xD9) {
-                    jpegSize = i + 2;  // Include end marker
-                    break;
-                }
-            }
-
-            /* If no end marker found, send entire buffer */
-            if (jpegSize == 0) {
-                jpegSize = IMAGE_BUFFER_SIZE;
-            }
-
-            /* Send image data in chunks for better reliability */
-            #define UART_CHUNK_SIZE 256
-            for (uint32_t i = 0; i < jpegSize; i += UART_CHUNK_SIZE) {
-                uint32_t chunkSize = (jpegSize - i) > UART_CHUNK_SIZE ? UART_CHUNK_SIZE : (jpegSize - i);
-                HAL_UART_Transmit(&huart1, &imageBuffer[i], chunkSize, 1000);
-            }
-
-            printf("IMG_END (size: %lu bytes)\r\n", jpegSize);
-        }
-    }
-
-
-    /* Step 6: Update pan angle for next scan (0 to 180 degrees) */
-    currentPanAngle += 30.0f;  // Increment by 30 degrees
-    if (currentPanAngle > 180.0f) {
-        currentPanAngle = 0.0f;
-        printf("\r\n--- Scan cycle complete, restarting ---\r\n\r\n");
-    }
-
-    /* Delay before next measurement */
-    HAL_Delay(500);
+    /* Handlers run one event at a time: range samples, frame ends and
+     * finished transfers from their interrupts, arrivals and timeouts from
+     * software timers. Sleep until the next interrupt when idle; the SCCB
+     * reset delay is counted by SysTick, so keep the tick while it runs.
+     */
+    Event_Dispatch();
+    Event_Idle(OV2640_GetSccbState() != OV2640_SCCB_DELAY);
   }
   /* USER CODE END 3 */
 }
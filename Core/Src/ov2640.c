@@ -16,13 +16,72 @@
 #include "ov2640_regs.h"
 #include "i2c.h"
 #include "dcmi.h"
+#include "timebase.h"
+#include <stdbool.h>
+#include <string.h>
 
 /* Private defines */
-#define SCCB_TIMEOUT    100   // SCCB timeout in ms
+#define SCCB_TIMEOUT        100   // SCCB timeout in ms
+#define SCCB_QUEUE_LENGTH   4     // Register sequences queued at once
+#define SCCB_RESET_DELAY_MS 10    // Settle time after a COM7 software reset
+#define INIT_TIMEOUT_MS     500   // Max time to load all init sequences
+#define JPEG_EOI_WINDOW     16    // Bytes searched back from DMA end for 0xFFD9
+#define QUALITY_DEADBAND    10    // Percent around the budget left alone
+
+#define OV2640_DSP_BANK     0x00  // 0xFF value selecting the DSP bank
+#define OV2640_SENSOR_BANK  0x01  // 0xFF value selecting the sensor bank
+#define OV2640_DSP_RESET    0xE0  // DSP bank reset control (strobe, not state)
+#define OV2640_DSP_QS       0x44  // JPEG quantization scale
+#define OV2640_COM7         0x12  // Sensor bank common control 7
+#define OV2640_COM7_SRST    0x80  // COM7 software reset bit
+
+/* Format table and suggested capture buffer size */
+typedef struct {
+    const OV2640_Reg_t *regs;
+    uint16_t count;
+    uint32_t bufferSize;
+} FormatConfig_t;
+
+/* Register sequence queued for the SCCB engine */
+typedef struct {
+    const OV2640_Reg_t *regs;
+    uint16_t count;
+} SccbSequence_t;
+
+/* Resolution tables, indexed by OV2640_Format_t. All cover the same
+ * registers, so switching between them is a register delta.
+ */
+static const FormatConfig_t formatConfig[OV2640_FORMAT_COUNT] = {
+    [OV2640_FORMAT_JPEG_QQVGA] = { OV2640_JPEG_QQVGA, OV2640_JPEG_QQVGA_SIZE, 8 * 1024 },
+    [OV2640_FORMAT_JPEG_QVGA]  = { OV2640_JPEG_QVGA,  OV2640_JPEG_QVGA_SIZE,  10 * 1024 },
+    [OV2640_FORMAT_JPEG_CIF]   = { OV2640_JPEG_CIF,   OV2640_JPEG_CIF_SIZE,   24 * 1024 },
+    [OV2640_FORMAT_JPEG_SVGA]  = { OV2640_JPEG_SVGA,  OV2640_JPEG_SVGA_SIZE,  48 * 1024 },
+};
 
 /* Private variables */
 static OV2640_Format_t currentFormat = OV2640_FORMAT_JPEG_QQVGA;
 
+/* Private variables - SCCB sequence engine */
+static SccbSequence_t sccbQueue[SCCB_QUEUE_LENGTH];
+static uint8_t sccbQueueHead = 0;
+static volatile uint8_t sccbQueueCount = 0;
+static uint16_t sccbIndex = 0;              // Next register in the head sequence
+static OV2640_Shadow_t sccbShadow;         // Values of completed writes
+static uint8_t sccbTxBuffer[2];
+static uint32_t sccbDelayStart = 0;
+static volatile OV2640_SccbState_t sccbState = OV2640_SCCB_IDLE;
+
+/* Private variables - JPEG quality control */
+static uint32_t frameBudget = 0;            // Target frame size, 0 = off
+static uint8_t qualityScale = OV2640_QS_DEFAULT;
+static OV2640_Reg_t qualityRegs[2];
+
+static uint8_t *captureBuffer = NULL;
+static uint32_t captureSize = 0;
+static volatile uint32_t captureLength = 0;
+static volatile OV2640_CaptureState_t captureState = OV2640_CAPTURE_IDLE;
+static volatile uint32_t captureStart_us = 0;   // Timebase at the frame's VSYNC
+
 /**
  * @brief  Write a register via SCCB (I2C)
  * @param  reg: Register address
@@ -37,6 +96,8 @@ OV2640_Status_t OV2640_WriteReg(uint8_t reg, uint8_t data)
         return OV2640_ERROR;
     }
 
+    OV2640_ShadowWrite(&sccbShadow, reg, data);
+
     return OV2640_OK;
 }
 
@@ -106,33 +167,192 @@ static void OV2640_HardwareReset(void)
 }
 
 /**
- * @brief  Write register array to OV2640
- * @param  regs: Pointer to register array
- * @param  size: Number of registers to write
- * @retval OV2640_Status_t
+ * @brief  Start the next queued register write
+ * @param  None
+ * @retval None
+ * @note   Runs with interrupts masked or from the I2C/SysTick interrupt
  */
-static OV2640_Status_t OV2640_WriteArray(const OV2640_Reg_t *regs, uint16_t size)
+static void OV2640_SccbNext(void)
 {
-    for (uint16_t i = 0; i < size; i++) {
-        if (OV2640_WriteReg(regs[i].reg, regs[i].val) != OV2640_OK) {
-            return OV2640_ERROR;
+    while (sccbQueueCount > 0) {
+        const SccbSequence_t *seq = &sccbQueue[sccbQueueHead];
+
+        if (sccbIndex >= seq->count) {
+            sccbQueueHead = (sccbQueueHead + 1) % SCCB_QUEUE_LENGTH;
+            sccbQueueCount--;
+            sccbIndex = 0;
+            continue;
+        }
+
+        sccbTxBuffer[0] = seq->regs[sccbIndex].reg;
+        sccbTxBuffer[1] = seq->regs[sccbIndex].val;
+        sccbState = OV2640_SCCB_BUSY;
+
+        if (HAL_I2C_Master_Transmit_IT(&hi2c2, OV2640_SCCB_ADDR, sccbTxBuffer, 2) != HAL_OK) {
+            OV2640_SccbErrorCallback();
         }
-        HAL_Delay(1); // Small delay between writes
+        return;
     }
 
-    return OV2640_OK;
+    sccbState = OV2640_SCCB_IDLE;
 }
 
 /**
- * @brief  Initialize OV2640 camera
- * @param  format: Image format (JPEG QQVGA or QVGA)
+ * @brief  Queue a register sequence for interrupt-driven writing
+ * @param  regs: Register array (must stay valid until written, e.g. const)
+ * @param  count: Number of registers
+ * @retval OV2640_OK, OV2640_ERROR if the queue is full or a write failed
+ * @note   Non-blocking. Writes go back to back; the engine only pauses
+ *         after a COM7 software reset. A failed write drops the queue and
+ *         the error sticks until OV2640_InitAsync() runs again.
+ */
+OV2640_Status_t OV2640_WriteSequence(const OV2640_Reg_t *regs, uint16_t count)
+{
+    OV2640_Status_t status = OV2640_OK;
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (sccbState == OV2640_SCCB_ERROR || sccbQueueCount >= SCCB_QUEUE_LENGTH) {
+        status = OV2640_ERROR;
+    } else if (count > 0) {
+        uint8_t tail = (sccbQueueHead + sccbQueueCount) % SCCB_QUEUE_LENGTH;
+
+        sccbQueue[tail].regs = regs;
+        sccbQueue[tail].count = count;
+        sccbQueueCount++;
+
+        if (sccbState == OV2640_SCCB_IDLE) {
+            OV2640_SccbNext();
+        }
+    }
+
+    __set_PRIMASK(primask);
+
+    return status;
+}
+
+/**
+ * @brief  Get SCCB engine state
+ * @param  None
+ * @retval OV2640_SccbState_t
+ */
+OV2640_SccbState_t OV2640_GetSccbState(void)
+{
+    return sccbState;
+}
+
+/**
+ * @brief  Wait until all queued register sequences are written
+ * @param  timeout_ms: Maximum time to wait
+ * @retval OV2640_OK, OV2640_TIMEOUT or OV2640_ERROR
+ */
+OV2640_Status_t OV2640_SccbWait(uint32_t timeout_ms)
+{
+    uint32_t tickstart = HAL_GetTick();
+
+    while (sccbState == OV2640_SCCB_BUSY || sccbState == OV2640_SCCB_DELAY) {
+        if ((HAL_GetTick() - tickstart) >= timeout_ms) {
+            return OV2640_TIMEOUT;
+        }
+    }
+
+    return (sccbState == OV2640_SCCB_IDLE) ? OV2640_OK : OV2640_ERROR;
+}
+
+/**
+ * @brief  Drop queued sequences and clear a sticky error
+ * @param  None
+ * @retval None
+ */
+static void OV2640_SccbReset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (sccbState == OV2640_SCCB_BUSY) {
+        HAL_I2C_Master_Abort_IT(&hi2c2, OV2640_SCCB_ADDR);
+    }
+    sccbQueueHead = 0;
+    sccbQueueCount = 0;
+    sccbIndex = 0;
+    sccbState = OV2640_SCCB_IDLE;
+    OV2640_ShadowReset(&sccbShadow);
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  SCCB write complete handler
+ * @param  None
+ * @retval None
+ * @note   This should be called from HAL_I2C_MasterTxCpltCallback in stm32f4xx_it.c
+ */
+void OV2640_SccbTxCpltCallback(void)
+{
+    if (sccbState != OV2640_SCCB_BUSY) {
+        return;
+    }
+
+    sccbIndex++;
+    OV2640_ShadowWrite(&sccbShadow, sccbTxBuffer[0], sccbTxBuffer[1]);
+
+    if (sccbShadow.bank == OV2640_SENSOR_BANK && sccbTxBuffer[0] == OV2640_COM7 &&
+        (sccbTxBuffer[1] & OV2640_COM7_SRST) != 0U) {
+        /* Registers are not accessible while the sensor resets */
+        sccbDelayStart = HAL_GetTick();
+        sccbState = OV2640_SCCB_DELAY;
+        return;
+    }
+
+    OV2640_SccbNext();
+}
+
+/**
+ * @brief  SCCB error handler (NACK, bus error, arbitration lost)
+ * @param  None
+ * @retval None
+ * @note   This should be called from HAL_I2C_ErrorCallback in stm32f4xx_it.c
+ */
+void OV2640_SccbErrorCallback(void)
+{
+    sccbQueueCount = 0;
+    sccbIndex = 0;
+    sccbState = OV2640_SCCB_ERROR;
+}
+
+/**
+ * @brief  Resume the SCCB engine after a reset delay
+ * @param  None
+ * @retval None
+ * @note   This should be called from SysTick_Handler in stm32f4xx_it.c
+ */
+void OV2640_SccbTick(void)
+{
+    /* Strictly greater: the first tick may come right after the write */
+    if (sccbState == OV2640_SCCB_DELAY && (HAL_GetTick() - sccbDelayStart) > SCCB_RESET_DELAY_MS) {
+        OV2640_SccbNext();
+    }
+}
+
+/**
+ * @brief  Start OV2640 initialization without waiting for register writes
+ * @param  format: Image format (OV2640_FORMAT_JPEG_*)
  * @retval OV2640_Status_t
+ * @note   Resets the sensor and checks its ID (blocking, a few tens of ms),
+ *         then queues the init tables on the SCCB engine and returns. Other
+ *         peripherals can be set up meanwhile; OV2640_WaitReady() finishes.
  */
-OV2640_Status_t OV2640_Init(OV2640_Format_t format)
+OV2640_Status_t OV2640_InitAsync(OV2640_Format_t format)
 {
     uint16_t chipID;
 
+    if (format >= OV2640_FORMAT_COUNT) {
+        return OV2640_ERROR;
+    }
+
     currentFormat = format;
+    qualityScale = OV2640_QS_DEFAULT;
+    OV2640_SccbReset();
 
     /* Hardware reset */
     OV2640_HardwareReset();
@@ -142,52 +362,447 @@ OV2640_Status_t OV2640_Init(OV2640_Format_t format)
         return OV2640_ID_ERROR;
     }
 
-    /* Load SVGA initialization sequence */
-    if (OV2640_WriteArray(OV2640_SVGA_Init, OV2640_SVGA_INIT_SIZE) != OV2640_OK) {
+    /* SVGA base setup, JPEG mode, then the resolution-specific table */
+    if (OV2640_WriteSequence(OV2640_SVGA_Init, OV2640_SVGA_INIT_SIZE) != OV2640_OK ||
+        OV2640_WriteSequence(OV2640_JPEG_Init, OV2640_JPEG_INIT_SIZE) != OV2640_OK) {
         return OV2640_ERROR;
     }
 
-    /* Load JPEG mode configuration */
-    if (OV2640_WriteArray(OV2640_JPEG_Init, OV2640_JPEG_INIT_SIZE) != OV2640_OK) {
+    return OV2640_WriteSequence(formatConfig[format].regs, formatConfig[format].count);
+}
+
+/**
+ * @brief  Finish initialization started by OV2640_InitAsync()
+ * @param  timeout_ms: Maximum time to wait for the register writes
+ * @retval OV2640_Status_t
+ */
+OV2640_Status_t OV2640_WaitReady(uint32_t timeout_ms)
+{
+    OV2640_Status_t status = OV2640_SccbWait(timeout_ms);
+
+    if (status != OV2640_OK) {
+        return status;
+    }
+
+    /* Enable JPEG mode in DCMI (if not already enabled) */
+    hdcmi.Init.JPEGMode = DCMI_JPEG_ENABLE;
+    if (HAL_DCMI_Init(&hdcmi) != HAL_OK) {
         return OV2640_ERROR;
     }
 
-    /* Load resolution-specific configuration */
-    if (format == OV2640_FORMAT_JPEG_QQVGA) {
-        if (OV2640_WriteArray(OV2640_JPEG_QQVGA, OV2640_JPEG_QQVGA_SIZE) != OV2640_OK) {
-            return OV2640_ERROR;
+    return OV2640_OK;
+}
+
+/**
+ * @brief  Initialize OV2640 camera
+ * @param  format: Image format (OV2640_FORMAT_JPEG_*)
+ * @retval OV2640_Status_t
+ */
+OV2640_Status_t OV2640_Init(OV2640_Format_t format)
+{
+    OV2640_Status_t status = OV2640_InitAsync(format);
+
+    if (status != OV2640_OK) {
+        return status;
+    }
+
+    return OV2640_WaitReady(INIT_TIMEOUT_MS);
+}
+
+/**
+ * @brief  Forget all register values (after a reset)
+ * @param  shadow: Register shadow
+ * @retval None
+ */
+void OV2640_ShadowReset(OV2640_Shadow_t *shadow)
+{
+    memset(shadow->valid, 0, sizeof(shadow->valid));
+    shadow->bank = 0xFF;
+}
+
+/**
+ * @brief  Record a completed register write
+ * @param  shadow: Register shadow
+ * @param  reg: Register address (0xFF selects the bank)
+ * @param  val: Value written
+ * @retval None
+ */
+void OV2640_ShadowWrite(OV2640_Shadow_t *shadow, uint8_t reg, uint8_t val)
+{
+    if (reg == OV2640_DSP_RA_DLMT) {
+        shadow->bank = val;
+        return;
+    }
+
+    if (shadow->bank > OV2640_SENSOR_BANK) {
+        return;
+    }
+
+    if (shadow->bank == OV2640_SENSOR_BANK && reg == OV2640_COM7 && (val & OV2640_COM7_SRST) != 0U) {
+        /* Software reset returns every register to its default */
+        memset(shadow->valid, 0, sizeof(shadow->valid));
+        return;
+    }
+
+    shadow->value[shadow->bank][reg] = val;
+    shadow->valid[shadow->bank][reg >> 3] |= (uint8_t)(1U << (reg & 7U));
+}
+
+/**
+ * @brief  Check whether a table entry has to be written
+ * @param  shadow: Register shadow (updated with the entry)
+ * @param  reg: Register address
+ * @param  val: Target value
+ * @retval true if the register is unknown or holds a different value
+ */
+static bool OV2640_ShadowDiffers(OV2640_Shadow_t *shadow, uint8_t reg, uint8_t val)
+{
+    uint8_t bank = shadow->bank;
+    bool differs = true;
+
+    if (bank <= OV2640_SENSOR_BANK) {
+        bool known = (shadow->valid[bank][reg >> 3] & (1U << (reg & 7U))) != 0U;
+        differs = !known || shadow->value[bank][reg] != val;
+    }
+
+    OV2640_ShadowWrite(shadow, reg, val);
+
+    return differs;
+}
+
+/**
+ * @brief  Compute the register writes needed to apply a format table
+ * @param  shadow: Current register values
+ * @param  table: Target format table (starts with a 0xFF bank select)
+ * @param  count: Number of table entries
+ * @param  delta: Destination for the writes, including bank selects
+ * @param  maxDelta: Capacity of delta
+ * @param  deltaCount: Number of entries written to delta
+ * @retval OV2640_OK, OV2640_ERROR if delta is too small
+ * @note   DSP reset (0xE0) entries are kept only if another DSP register
+ *         changes. Once COM7 changes, the sensor re-derives its window
+ *         registers, so every later sensor entry of the table is written.
+ */
+OV2640_Status_t OV2640_BuildDelta(const OV2640_Shadow_t *shadow, const OV2640_Reg_t *table,
+                                  uint16_t count, OV2640_Reg_t *delta, uint16_t maxDelta,
+                                  uint16_t *deltaCount)
+{
+    static OV2640_Shadow_t pending;     // Shadow as the table would leave it (static: 580 bytes)
+    bool dspChanged = false;
+    bool sensorReload = false;
+    uint8_t bank = shadow->bank;
+    uint16_t n = 0;
+
+    /* Pass 1: does any real DSP register change? */
+    pending = *shadow;
+    for (uint16_t i = 0; i < count && !dspChanged; i++) {
+        if (table[i].reg == OV2640_DSP_RA_DLMT) {
+            OV2640_ShadowWrite(&pending, table[i].reg, table[i].val);
+        } else if (pending.bank == OV2640_DSP_BANK && table[i].reg != OV2640_DSP_RESET) {
+            dspChanged = OV2640_ShadowDiffers(&pending, table[i].reg, table[i].val);
+        } else if (pending.bank <= OV2640_SENSOR_BANK) {
+            OV2640_ShadowWrite(&pending, table[i].reg, table[i].val);
+        }
+    }
+
+    /* Pass 2: emit changed registers with the bank selects they need */
+    pending = *shadow;
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t reg = table[i].reg;
+        uint8_t val = table[i].val;
+        bool write;
+
+        if (reg == OV2640_DSP_RA_DLMT) {
+            OV2640_ShadowWrite(&pending, reg, val);
+            continue;
+        }
+
+        if (pending.bank == OV2640_DSP_BANK && reg == OV2640_DSP_RESET) {
+            write = dspChanged;
+        } else {
+            write = OV2640_ShadowDiffers(&pending, reg, val);
+            if (pending.bank == OV2640_SENSOR_BANK) {
+                write = write || sensorReload;
+                sensorReload = sensorReload || (write && reg == OV2640_COM7);
+            }
+        }
+
+        if (!write) {
+            continue;
+        }
+
+        if (bank != pending.bank) {
+            if (n >= maxDelta) {
+                return OV2640_ERROR;
+            }
+            bank = pending.bank;
+            delta[n].reg = OV2640_DSP_RA_DLMT;
+            delta[n].val = bank;
+            n++;
         }
-    } else if (format == OV2640_FORMAT_JPEG_QVGA) {
-        if (OV2640_WriteArray(OV2640_JPEG_QVGA, OV2640_JPEG_QVGA_SIZE) != OV2640_OK) {
+
+        if (n >= maxDelta) {
             return OV2640_ERROR;
         }
+        delta[n].reg = reg;
+        delta[n].val = val;
+        n++;
     }
 
-    /* Enable JPEG mode in DCMI (if not already enabled) */
-    hdcmi.Init.JPEGMode = DCMI_JPEG_ENABLE;
-    if (HAL_DCMI_Init(&hdcmi) != HAL_OK) {
+    *deltaCount = n;
+
+    return OV2640_OK;
+}
+
+/**
+ * @brief  Switch resolution by writing only the registers that change
+ * @param  format: Target image format (OV2640_FORMAT_JPEG_*)
+ * @retval OV2640_Status_t
+ * @note   Blocks until the delta is written (a few ms). Not allowed while a
+ *         capture runs. The first frame after a switch may still have the
+ *         old size; OV2640_WaitCapture() locates its end either way.
+ */
+OV2640_Status_t OV2640_SetFormat(OV2640_Format_t format)
+{
+    static OV2640_Reg_t delta[OV2640_DELTA_MAX];
+    uint16_t deltaCount = 0;
+
+    if (format >= OV2640_FORMAT_COUNT || captureState == OV2640_CAPTURE_BUSY ||
+        sccbState != OV2640_SCCB_IDLE) {
         return OV2640_ERROR;
     }
 
+    if (OV2640_BuildDelta(&sccbShadow, formatConfig[format].regs, formatConfig[format].count,
+                          delta, OV2640_DELTA_MAX, &deltaCount) != OV2640_OK) {
+        return OV2640_ERROR;
+    }
+
+    if (deltaCount > 0) {
+        if (OV2640_WriteSequence(delta, deltaCount) != OV2640_OK) {
+            return OV2640_ERROR;
+        }
+
+        OV2640_Status_t status = OV2640_SccbWait(SCCB_TIMEOUT);
+        if (status != OV2640_OK) {
+            return status;
+        }
+    }
+
+    currentFormat = format;
+
     return OV2640_OK;
 }
 
+/**
+ * @brief  Get the current image format
+ * @param  None
+ * @retval OV2640_Format_t
+ */
+OV2640_Format_t OV2640_GetFormat(void)
+{
+    return currentFormat;
+}
+
+/**
+ * @brief  Compute the next JPEG quality scale from the last frame size
+ * @param  qs: Quality scale used for the last frame
+ * @param  frameBytes: Last frame size in bytes
+ * @param  budget: Target frame size in bytes (0 = keep qs)
+ * @param  truncated: Last frame did not fit into the buffer
+ * @retval New quality scale (OV2640_QS_MIN..OV2640_QS_MAX)
+ * @note   JPEG size is roughly proportional to 1 / qs, so qs * size / budget
+ *         would hit the budget; the step goes halfway there to ride out
+ *         scene changes. A truncated frame's size is unknown, so qs doubles.
+ */
+uint8_t OV2640_NextQualityScale(uint8_t qs, uint32_t frameBytes, uint32_t budget, bool truncated)
+{
+    uint32_t next;
+
+    if (budget == 0) {
+        return qs;
+    }
+
+    if (truncated) {
+        next = (uint32_t)qs * 2U;
+    } else {
+        uint64_t scaled = (uint64_t)frameBytes * 100U;
+
+        if (scaled >= (uint64_t)budget * (100U - QUALITY_DEADBAND) &&
+            scaled <= (uint64_t)budget * (100U + QUALITY_DEADBAND)) {
+            return qs;
+        }
+
+        uint32_t target = (uint32_t)(((uint64_t)qs * frameBytes + budget / 2U) / budget);
+        next = (qs + target) / 2U;
+
+        /* Always move at least one step outside the dead band */
+        if (frameBytes > budget && next <= qs) {
+            next = qs + 1U;
+        } else if (frameBytes < budget && next >= qs) {
+            next = (qs > 0U) ? qs - 1U : 0U;
+        }
+    }
+
+    if (next < OV2640_QS_MIN) {
+        next = OV2640_QS_MIN;
+    } else if (next > OV2640_QS_MAX) {
+        next = OV2640_QS_MAX;
+    }
+
+    return (uint8_t)next;
+}
+
+/**
+ * @brief  Write the JPEG quality scale (DSP register 0x44)
+ * @param  qs: Quality scale, lower is better quality and larger frames
+ * @retval OV2640_OK, OV2640_ERROR if the SCCB engine is busy
+ * @note   Non-blocking, takes effect from the next frame or the one after.
+ */
+OV2640_Status_t OV2640_SetQualityScale(uint8_t qs)
+{
+    if (sccbState != OV2640_SCCB_IDLE) {
+        return OV2640_ERROR;
+    }
+
+    qualityScale = qs;
+    qualityRegs[0].reg = OV2640_DSP_RA_DLMT;
+    qualityRegs[0].val = OV2640_DSP_BANK;
+    qualityRegs[1].reg = OV2640_DSP_QS;
+    qualityRegs[1].val = qs;
+
+    return OV2640_WriteSequence(qualityRegs, 2);
+}
+
+/**
+ * @brief  Get the JPEG quality scale currently in use
+ * @param  None
+ * @retval Quality scale
+ */
+uint8_t OV2640_GetQualityScale(void)
+{
+    return qualityScale;
+}
+
+/**
+ * @brief  Set the frame size the quality controller aims for
+ * @param  bytes: Target JPEG size in bytes, 0 disables the controller
+ * @retval None
+ * @note   The controller runs in OV2640_WaitCapture() after every frame.
+ *         The effective target never exceeds 3/4 of the capture buffer.
+ */
+void OV2640_SetFrameBudget(uint32_t bytes)
+{
+    frameBudget = bytes;
+
+    if (bytes != 0) {
+        OV2640_SetQualityScale(qualityScale);
+    }
+}
+
+/**
+ * @brief  Derive a frame budget from the link speed and scan period
+ * @param  baudrate: UART baud rate (8N1, 10 bits per byte)
+ * @param  period_ms: Time between frames
+ * @param  sharePercent: Part of the link given to image data (rest is
+ *         packet overhead, telemetry and log text)
+ * @retval Bytes per frame that the link can carry
+ */
+uint32_t OV2640_FrameBudget(uint32_t baudrate, uint32_t period_ms, uint32_t sharePercent)
+{
+    return (uint32_t)(((uint64_t)baudrate / 10U) * period_ms * sharePercent / (1000U * 100U));
+}
+
+/**
+ * @brief  Get the capture buffer size suggested for a format
+ * @param  format: Image format
+ * @retval Buffer size in bytes (typical JPEG size with headroom)
+ */
+uint32_t OV2640_GetFrameSizeHint(OV2640_Format_t format)
+{
+    if (format >= OV2640_FORMAT_COUNT) {
+        return 0;
+    }
+
+    return formatConfig[format].bufferSize;
+}
+
+/**
+ * @brief  DMA transfer complete handler for the DCMI stream
+ * @param  hdma: DMA handle
+ * @retval None
+ * @note   Replaces the HAL internal handler. The stream is circular, so a
+ *         transfer complete before frame end means the JPEG frame did not
+ *         fit into the buffer and the DMA is about to overwrite its start.
+ */
+static void OV2640_DMAXferCplt(DMA_HandleTypeDef *hdma)
+{
+    if (captureState == OV2640_CAPTURE_BUSY) {
+        __HAL_DMA_DISABLE(hdma);
+        hdcmi.Instance->CR &= ~DCMI_CR_CAPTURE;
+        captureState = OV2640_CAPTURE_OVERRUN;
+    }
+}
+
+/**
+ * @brief  Locate JPEG end-of-image marker (0xFF 0xD9) near the end of the data
+ * @param  buffer: Image buffer
+ * @param  length: Number of bytes written by DMA
+ * @retval Frame length including the marker, 0 if not found
+ * @note   DCMI transfers whole words, so the marker sits in the last few
+ *         words followed by padding; only that tail is searched.
+ */
+static uint32_t OV2640_FindJpegEnd(const uint8_t *buffer, uint32_t length)
+{
+    uint32_t start = (length > JPEG_EOI_WINDOW) ? (length - JPEG_EOI_WINDOW) : 0;
+
+    for (uint32_t i = length; i >= start + 2; i--) {
+        if (buffer[i - 2] == 0xFF && buffer[i - 1] == 0xD9) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
 /**
  * @brief  Start DCMI capture to memory buffer
  * @param  buffer: Pointer to image buffer
  * @param  buffer_size: Size of buffer in bytes
  * @retval OV2640_Status_t
- * @note   Buffer must be 32-bit aligned for DMA
+ * @note   Buffer must be 32-bit aligned for DMA. Non-blocking, completion is
+ *         reported via OV2640_GetCaptureState() or OV2640_WaitCapture().
  */
 OV2640_Status_t OV2640_StartCapture(uint8_t *buffer, uint32_t buffer_size)
 {
+    if (captureState == OV2640_CAPTURE_BUSY) {
+        return OV2640_ERROR;
+    }
+
+    captureBuffer = buffer;
+    captureSize = buffer_size;
+    captureLength = 0;
+    captureState = OV2640_CAPTURE_BUSY;
+    hdcmi.ErrorCode = HAL_DCMI_ERROR_NONE;
+
+    /* HAL only enables the frame interrupt after a full DMA buffer, and a
+     * JPEG frame is normally shorter than that. Line events are unused; the
+     * first VSYNC stamps the frame start and then disables itself.
+     */
+    captureStart_us = Timebase_Now();
+    __HAL_DCMI_DISABLE_IT(&hdcmi, DCMI_IT_LINE);
+    __HAL_DCMI_ENABLE_IT(&hdcmi, DCMI_IT_FRAME | DCMI_IT_ERR | DCMI_IT_OVR | DCMI_IT_VSYNC);
+
     /* Start DCMI DMA capture
      * buffer_size must be in words (divide by 4) for HAL API
      */
     if (HAL_DCMI_Start_DMA(&hdcmi, DCMI_MODE_SNAPSHOT, (uint32_t)buffer, buffer_size / 4) != HAL_OK) {
+        captureState = OV2640_CAPTURE_IDLE;
         return OV2640_ERROR;
     }
 
+    /* Detect buffer wrap-around ourselves */
+    hdcmi.DMA_Handle->XferCpltCallback = OV2640_DMAXferCplt;
+
     return OV2640_OK;
 }
 
@@ -204,3 +819,152 @@ OV2640_Status_t OV2640_StopCapture(void)
 
     return OV2640_OK;
 }
+
+/**
+ * @brief  Get current capture state
+ * @param  None
+ * @retval OV2640_CaptureState_t
+ */
+OV2640_CaptureState_t OV2640_GetCaptureState(void)
+{
+    return captureState;
+}
+
+/**
+ * @brief  Start time of the last captured frame
+ * @param  None
+ * @retval Timebase in microseconds of the VSYNC that opened the frame
+ *         (the call to OV2640_StartCapture() if no VSYNC was seen)
+ */
+uint32_t OV2640_GetFrameTimestamp(void)
+{
+    return captureStart_us;
+}
+
+/**
+ * @brief  Wait for the capture started by OV2640_StartCapture() to finish
+ * @param  timeout_ms: Maximum time to wait for frame end
+ * @param  length: Pointer to store the frame length in bytes (may be NULL)
+ * @retval OV2640_OK, OV2640_OVERRUN (length = buffer size), OV2640_TIMEOUT
+ *         or OV2640_ERROR
+ * @note   Returns as soon as the frame event arrives, and always leaves the
+ *         DCMI stopped.
+ */
+OV2640_Status_t OV2640_WaitCapture(uint32_t timeout_ms, uint32_t *length)
+{
+    uint32_t tickstart = HAL_GetTick();
+    uint32_t frameLength = 0;
+    OV2640_Status_t status;
+
+    while (captureState == OV2640_CAPTURE_BUSY) {
+        if ((HAL_GetTick() - tickstart) >= timeout_ms) {
+            break;
+        }
+    }
+
+    /* Stopping the stream also flushes the DMA FIFO into the buffer */
+    OV2640_StopCapture();
+
+    switch (captureState) {
+    case OV2640_CAPTURE_DONE:
+        frameLength = OV2640_FindJpegEnd(captureBuffer, captureLength);
+        status = (frameLength != 0) ? OV2640_OK : OV2640_ERROR;
+        break;
+    case OV2640_CAPTURE_OVERRUN:
+        frameLength = captureSize;
+        status = OV2640_OVERRUN;
+        break;
+    case OV2640_CAPTURE_BUSY:
+        status = OV2640_TIMEOUT;
+        break;
+    default:
+        status = OV2640_ERROR;
+        break;
+    }
+
+    captureState = OV2640_CAPTURE_IDLE;
+
+    /* Steer the next frames towards the byte budget */
+    if (frameBudget != 0 && (status == OV2640_OK || status == OV2640_OVERRUN)) {
+        uint32_t budget = (frameBudget < captureSize / 4U * 3U) ? frameBudget : captureSize / 4U * 3U;
+        uint8_t next = OV2640_NextQualityScale(qualityScale, frameLength, budget, status == OV2640_OVERRUN);
+
+        if (next != qualityScale) {
+            OV2640_SetQualityScale(next);
+        }
+    }
+
+    if (length != NULL) {
+        *length = frameLength;
+    }
+
+    return status;
+}
+
+/**
+ * @brief  Capture a single JPEG frame (blocking until frame end or timeout)
+ * @param  buffer: Pointer to image buffer (32-bit aligned)
+ * @param  buffer_size: Size of buffer in bytes
+ * @param  timeout_ms: Maximum time to wait for frame end
+ * @param  length: Pointer to store the frame length in bytes (may be NULL)
+ * @retval OV2640_Status_t (see OV2640_WaitCapture)
+ */
+OV2640_Status_t OV2640_CaptureFrame(uint8_t *buffer, uint32_t buffer_size,
+                                    uint32_t timeout_ms, uint32_t *length)
+{
+    if (OV2640_StartCapture(buffer, buffer_size) != OV2640_OK) {
+        return OV2640_ERROR;
+    }
+
+    return OV2640_WaitCapture(timeout_ms, length);
+}
+
+/**
+ * @brief  DCMI VSYNC event handler
+ * @param  None
+ * @retval None
+ * @note   This should be called from HAL_DCMI_VsyncEventCallback in stm32f4xx_it.c
+ */
+void OV2640_VsyncEventCallback(void)
+{
+    /* Only the VSYNC opening the captured frame is of interest */
+    __HAL_DCMI_DISABLE_IT(&hdcmi, DCMI_IT_VSYNC);
+
+    if (captureState == OV2640_CAPTURE_BUSY) {
+        captureStart_us = Timebase_Now();
+    }
+}
+
+/**
+ * @brief  DCMI frame event handler
+ * @param  None
+ * @retval None
+ * @note   This should be called from HAL_DCMI_FrameEventCallback in stm32f4xx_it.c
+ */
+void OV2640_FrameEventCallback(void)
+{
+    if (captureState == OV2640_CAPTURE_BUSY) {
+        /* Bytes received = words requested - words remaining (NDTR) */
+        captureLength = ((captureSize / 4U) - __HAL_DMA_GET_COUNTER(hdcmi.DMA_Handle)) * 4U;
+        captureState = OV2640_CAPTURE_DONE;
+    }
+}
+
+/**
+ * @brief  DCMI error handler
+ * @param  None
+ * @retval None
+ * @note   This should be called from HAL_DCMI_ErrorCallback in stm32f4xx_it.c
+ */
+void OV2640_ErrorCallback(void)
+{
+    /* DMA FIFO errors are reported for DCMI streams but are not fatal */
+    if (hdcmi.DMA_Handle->ErrorCode == HAL_DMA_ERROR_FE &&
+        hdcmi.ErrorCode == HAL_DCMI_ERROR_NONE) {
+        return;
+    }
+
+    if (captureState == OV2640_CAPTURE_BUSY) {
+        captureState = OV2640_CAPTURE_ERROR;
+    }
+}
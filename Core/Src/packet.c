@@ -0,0 +1,189 @@
+/**
+ ******************************************************************************
+ * @file    packet.c
+ * @brief   Channel-multiplexed packet framing (COBS + CRC-16) for USART1
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    Packet on the wire:
+ *            0x00 | COBS( channel | length LE16 | payload | CRC-16 LE ) | 0x00
+ *          CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) covers channel,
+ *          length and payload. Console text never contains 0x00, so the
+ *          receiver finds packets between text lines by the delimiters.
+ ******************************************************************************
+ */
+
+#include "packet.h"
+
+/**
+ * @brief  Feed bytes into a CRC-16/CCITT-FALSE
+ * @param  crc: Running CRC (0xFFFF to start)
+ * @param  data: Input bytes
+ * @param  length: Number of bytes
+ * @retval Updated CRC
+ */
+static uint16_t Packet_Crc16Update(uint16_t crc, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief  Compute CRC-16/CCITT-FALSE
+ * @param  data: Input bytes
+ * @param  length: Number of bytes
+ * @retval CRC value
+ */
+uint16_t Packet_Crc16(const uint8_t *data, size_t length)
+{
+    return Packet_Crc16Update(0xFFFF, data, length);
+}
+
+/**
+ * @brief  Push one byte through the COBS encoder
+ * @param  encoder: Encoder state
+ * @param  byte: Raw byte
+ * @retval None
+ */
+static void Packet_CobsPut(Packet_Encoder_t *encoder, uint8_t byte)
+{
+    if (byte != 0) {
+        encoder->output[encoder->length++] = byte;
+        encoder->code++;
+    }
+
+    if (byte == 0 || encoder->code == 0xFF) {
+        encoder->output[encoder->codeIndex] = encoder->code;
+        encoder->codeIndex = encoder->length++;
+        encoder->code = 1;
+    }
+}
+
+/**
+ * @brief  Start a packet: leading delimiter, channel and payload length
+ * @param  encoder: Encoder state
+ * @param  output: Destination, at least PACKET_WIRE_SIZE(length) bytes
+ * @param  channel: PACKET_CHANNEL_*
+ * @param  length: Total payload length that will be appended
+ * @retval None
+ */
+void Packet_Begin(Packet_Encoder_t *encoder, uint8_t *output, uint8_t channel, uint16_t length)
+{
+    uint8_t header[3] = { channel, (uint8_t)length, (uint8_t)(length >> 8) };
+
+    output[0] = 0x00;
+    encoder->output = output;
+    encoder->codeIndex = 1;
+    encoder->length = 2;
+    encoder->code = 1;
+    encoder->crc = 0xFFFF;
+
+    Packet_Append(encoder, header, sizeof(header));
+}
+
+/**
+ * @brief  Append payload bytes to a packet
+ * @param  encoder: Encoder state
+ * @param  data: Payload bytes
+ * @param  length: Number of bytes
+ * @retval None
+ */
+void Packet_Append(Packet_Encoder_t *encoder, const uint8_t *data, size_t length)
+{
+    encoder->crc = Packet_Crc16Update(encoder->crc, data, length);
+
+    for (size_t i = 0; i < length; i++) {
+        Packet_CobsPut(encoder, data[i]);
+    }
+}
+
+/**
+ * @brief  Finish a packet: CRC trailer and closing delimiter
+ * @param  encoder: Encoder state
+ * @retval Packet length on the wire
+ */
+size_t Packet_End(Packet_Encoder_t *encoder)
+{
+    uint16_t crc = encoder->crc;
+
+    Packet_CobsPut(encoder, (uint8_t)crc);
+    Packet_CobsPut(encoder, (uint8_t)(crc >> 8));
+
+    encoder->output[encoder->codeIndex] = encoder->code;
+    encoder->output[encoder->length++] = 0x00;
+
+    return encoder->length;
+}
+
+/**
+ * @brief  Encode a complete packet from one payload buffer
+ * @param  output: Destination, at least PACKET_WIRE_SIZE(length) bytes
+ * @param  channel: PACKET_CHANNEL_*
+ * @param  payload: Payload bytes
+ * @param  length: Payload length
+ * @retval Packet length on the wire
+ */
+size_t Packet_Encode(uint8_t *output, uint8_t channel, const uint8_t *payload, uint16_t length)
+{
+    Packet_Encoder_t encoder;
+
+    Packet_Begin(&encoder, output, channel, length);
+    Packet_Append(&encoder, payload, length);
+
+    return Packet_End(&encoder);
+}
+
+/**
+ * @brief  COBS-encode a buffer (no delimiters)
+ * @param  input: Bytes to encode
+ * @param  length: Number of bytes
+ * @param  output: Destination, at least length + length / 254 + 1 bytes
+ * @retval Encoded length
+ */
+size_t Packet_CobsEncode(const uint8_t *input, size_t length, uint8_t *output)
+{
+    Packet_Encoder_t encoder = { output, 1, 0, 1, 0 };
+
+    for (size_t i = 0; i < length; i++) {
+        Packet_CobsPut(&encoder, input[i]);
+    }
+    output[encoder.codeIndex] = encoder.code;
+
+    return encoder.length;
+}
+
+/**
+ * @brief  Decode a COBS block (without delimiters)
+ * @param  input: Encoded bytes
+ * @param  length: Number of encoded bytes
+ * @param  output: Destination, at least length bytes
+ * @retval Decoded length, 0 if the block is malformed
+ */
+size_t Packet_CobsDecode(const uint8_t *input, size_t length, uint8_t *output)
+{
+    size_t inIndex = 0;
+    size_t outIndex = 0;
+
+    while (inIndex < length) {
+        uint8_t code = input[inIndex++];
+
+        if (code == 0 || inIndex + code - 1 > length) {
+            return 0;
+        }
+
+        for (uint8_t i = 1; i < code; i++) {
+            output[outIndex++] = input[inIndex++];
+        }
+
+        if (code != 0xFF && inIndex < length) {
+            output[outIndex++] = 0;
+        }
+    }
+
+    return outIndex;
+}
@@ -0,0 +1,131 @@
+/**
+ ******************************************************************************
+ * @file    ring_buffer.c
+ * @brief   Lock-free single-producer/single-consumer ring of fixed-size
+ *          elements
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    One side (typically an interrupt) pushes, the other (typically
+ *          the main loop) pops; neither masks interrupts. Each index has a
+ *          single writer and 32-bit accesses are atomic on the Cortex-M4,
+ *          so the only ordering needed is between element data and index:
+ *          - Push: copy the element, DMB, then publish the new head
+ *          - Pop:  read head, DMB, copy the element out, DMB, then release
+ *                  the slot by publishing the new tail
+ *          Indices run freely and wrap at 2^32; the capacity is a power of
+ *          two so that the slot is index & mask and head - tail is the fill
+ *          level across the wrap.
+ *
+ *          Several producers (e.g. interrupts of different priorities) must
+ *          serialize their pushes themselves.
+ *
+ *          No HAL dependency: the barrier comes from mem_barrier.h, so the
+ *          ring also builds and is stress-tested on the host (tests/host).
+ ******************************************************************************
+ */
+
+#include "ring_buffer.h"
+#include "mem_barrier.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Orders element copies against index updates */
+#define RING_BARRIER()          MEM_BARRIER()
+
+/**
+ * @brief  Set up a ring on caller-provided storage
+ * @param  ring: Ring state
+ * @param  storage: capacity * elementSize bytes, suitably aligned for the element type
+ * @param  elementSize: Bytes per element
+ * @param  capacity: Number of elements, a power of two
+ * @retval false if the capacity is not a power of two or an argument is zero
+ * @note   Call before either side uses the ring.
+ */
+bool Ring_Init(Ring_t *ring, void *storage, uint32_t elementSize, uint32_t capacity)
+{
+    if (storage == NULL || elementSize == 0U || capacity == 0U ||
+        (capacity & (capacity - 1U)) != 0U) {
+        return false;
+    }
+
+    ring->storage = (uint8_t *)storage;
+    ring->elementSize = elementSize;
+    ring->mask = capacity - 1U;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+
+    return true;
+}
+
+/**
+ * @brief  Append an element
+ * @param  ring: Ring state
+ * @param  element: Element to copy in (elementSize bytes)
+ * @retval false if the ring is full (counted in ring->dropped)
+ * @note   Producer only.
+ */
+bool Ring_Push(Ring_t *ring, const void *element)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail > ring->mask) {
+        ring->dropped++;
+        return false;
+    }
+
+    memcpy(&ring->storage[(head & ring->mask) * ring->elementSize], element, ring->elementSize);
+
+    /* Publish the element before moving the head */
+    RING_BARRIER();
+    ring->head = head + 1U;
+
+    return true;
+}
+
+/**
+ * @brief  Take the oldest element
+ * @param  ring: Ring state
+ * @param  element: Receives the element (elementSize bytes)
+ * @retval false if the ring is empty
+ * @note   Consumer only.
+ */
+bool Ring_Pop(Ring_t *ring, void *element)
+{
+    uint32_t tail = ring->tail;
+
+    if (tail == ring->head) {
+        return false;
+    }
+
+    /* Don't read the slot ahead of the head that published it */
+    RING_BARRIER();
+    memcpy(element, &ring->storage[(tail & ring->mask) * ring->elementSize], ring->elementSize);
+
+    /* Read the element before releasing the slot */
+    RING_BARRIER();
+    ring->tail = tail + 1U;
+
+    return true;
+}
+
+/**
+ * @brief  Drop every element currently in the ring
+ * @param  ring: Ring state
+ * @retval None
+ * @note   Consumer only. Elements pushed concurrently may survive.
+ */
+void Ring_Discard(Ring_t *ring)
+{
+    ring->tail = ring->head;
+}
+
+/**
+ * @brief  Number of elements in the ring
+ * @param  ring: Ring state
+ * @retval Fill level, a snapshot when called from the other side
+ */
+uint32_t Ring_Count(const Ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
@@ -0,0 +1,405 @@
+/**
+ ******************************************************************************
+ * @file    scan_pipeline.c
+ * @brief   Stop-and-go scan as a pipeline of event-driven stages
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    Four stages, each a small state machine (see ScanPipeline_Step):
+ *          - Gimbal:   move to a stop (trapezoid, predicted arrival), hold
+ *                      until the stop is measured, move on
+ *          - Range:    SCAN_RANGE_SAMPLES fresh samples at rest
+ *          - Capture:  one JPEG into a pool buffer (DCMI DMA, no waiting)
+ *          - Transmit: oldest ready frame over UART DMA
+ *          Range and capture run in parallel while the gimbal holds; the
+ *          frame of stop N is transmitted while the gimbal moves to and
+ *          measures stop N+1. The cycle time is set by the slowest stage,
+ *          normally the image transfer; a full frame pool holds the gimbal
+ *          at its stop until the link catches up.
+ *
+ *          The stages run on the event loop (event_loop.c): range samples,
+ *          frame ends and finished transfers are posted by their interrupts,
+ *          the predicted arrival and the capture timeout are software
+ *          timers. Each event runs the stages once; conditions such as a
+ *          free frame buffer are sampled from the drivers at that point.
+ *
+ *          Stops are every SCAN_PAN_STEP_DEG, or with SCAN_ADAPTIVE chosen
+ *          by the planner (scan_planner.c) from the ranges measured so far.
+ ******************************************************************************
+ */
+
+#include "scan_pipeline.h"
+#include "main.h"
+#include "servo_driver.h"
+#include "servo_motion.h"
+#include "hcsr04.h"
+#include "ov2640.h"
+#include "frame_pool.h"
+#include "serial_link.h"
+#include "packet.h"
+#include "telemetry.h"
+#include "event_loop.h"
+#include "scan_planner.h"
+#include <stdio.h>
+
+/* Sensor measured at each stop (rangerConfig[0] in main.c) */
+#define SCAN_RANGER             0U
+
+/* Private variables */
+static ScanPipeline_t pipeline;
+static float panAngle = 0.0f;                   // Current stop
+
+#ifdef SCAN_ADAPTIVE
+/* Adaptive stops of the current sweep */
+static ScanPlan_t plan;
+static uint32_t planStartTick = 0;
+#endif
+
+/* Capture stage */
+static Frame_t *captureFrame = NULL;
+static uint32_t captureTick = 0;
+static uint32_t captureLength = 0;
+static OV2640_Status_t captureStatus = OV2640_ERROR;
+
+/* Transmit stage */
+static Frame_t *txFrame = NULL;
+
+/**
+ * @brief  UART DMA completion callback for image transfers
+ * @retval None
+ * @note   Called from interrupt context
+ */
+static void ScanPipeline_TxComplete(void)
+{
+    FramePool_Release(txFrame);
+    Event_Post(EVENT_TX_DONE, 0);
+}
+
+/**
+ * @brief  Capture stage: start DCMI into a free pool buffer
+ * @retval None
+ */
+static void ScanPipeline_StartCapture(void)
+{
+    captureFrame = FramePool_Acquire(OV2640_GetFrameSizeHint(OV2640_GetFormat()));
+    captureTick = HAL_GetTick();
+    captureLength = 0;
+    captureStatus = OV2640_ERROR;
+
+    if (captureFrame == NULL ||
+        OV2640_StartCapture(captureFrame->data, captureFrame->size) != OV2640_OK) {
+        if (captureFrame != NULL) {
+            FramePool_Release(captureFrame);
+            captureFrame = NULL;
+        }
+        Event_Post(EVENT_FRAME_DONE, 0);
+        return;
+    }
+
+    Event_StartTimer(EVENT_CAPTURE_TIMEOUT, SCAN_CAPTURE_TIMEOUT_MS, 0);
+}
+
+/**
+ * @brief  Capture stage: check for frame end and hand the frame on
+ * @retval true once the capture has finished (any status)
+ */
+static bool ScanPipeline_CaptureFinished(void)
+{
+    if (captureFrame == NULL) {
+        return true;    // Start failed
+    }
+
+    if (OV2640_GetCaptureState() == OV2640_CAPTURE_BUSY &&
+        (HAL_GetTick() - captureTick) < SCAN_CAPTURE_TIMEOUT_MS) {
+        return false;
+    }
+
+    /* Frame event seen (or timed out): stop DCMI and validate the JPEG */
+    Event_StopTimer(EVENT_CAPTURE_TIMEOUT);
+    captureStatus = OV2640_WaitCapture(0, &captureLength);
+    if (captureStatus == OV2640_OK) {
+        captureFrame->timestamp_us = OV2640_GetFrameTimestamp();
+        FramePool_MarkReady(captureFrame, captureLength, 0);
+    } else {
+        /* A truncated JPEG is not decodable, don't spend wire time on it;
+         * the driver has already lowered the quality.
+         */
+        FramePool_Release(captureFrame);
+    }
+    captureFrame = NULL;
+
+    return true;
+}
+
+/**
+ * @brief  Transmit stage: queue the oldest ready frame
+ * @retval None
+ * @note   The frame goes out as PACKET_CHANNEL_IMAGE chunks tagged with its
+ *         sequence number; log text and telemetry are sent between chunks.
+ */
+static void ScanPipeline_StartTransfer(void)
+{
+    Frame_t *frame = FramePool_NextReady();
+
+    if (frame == NULL) {
+        Event_Post(EVENT_TX_DONE, 0);
+        return;
+    }
+
+    FramePool_MarkTransmitting(frame);
+    txFrame = frame;
+    if (SerialLink_SendAsync(PACKET_CHANNEL_IMAGE, (uint16_t)frame->sequence,
+                             frame->data, frame->length, ScanPipeline_TxComplete) != SERIAL_LINK_OK) {
+        FramePool_Release(frame);
+        Event_Post(EVENT_TX_DONE, 0);
+    }
+}
+
+/**
+ * @brief  Send the telemetry of the current stop and advance to the next
+ * @retval None
+ */
+static void ScanPipeline_Report(void)
+{
+    Telemetry_Sample_t sample = {0};
+    uint16_t distance_mm;
+
+    sample.timestamp_ms = HAL_GetTick();
+    sample.pan_cdeg = (int16_t)(panAngle * 100.0f);
+    sample.tilt_cdeg = (int16_t)(SCAN_TILT_DEG * 100.0f);
+    if (pipeline.ranger && HCSR04_GetFilteredDistanceMm(SCAN_RANGER, &distance_mm)) {
+        sample.distance_mm = distance_mm;
+        sample.flags |= TELEMETRY_FLAG_RANGE_VALID;
+    } else {
+        sample.flags |= TELEMETRY_FLAG_RANGE_TIMEOUT;
+    }
+
+    if (pipeline.camera) {
+        if (captureStatus == OV2640_OK) {
+            sample.flags |= TELEMETRY_FLAG_IMAGE_CAPTURED;
+        } else if (captureStatus == OV2640_OVERRUN) {
+            sample.flags |= TELEMETRY_FLAG_IMAGE_TRUNCATED;
+        }
+    }
+    Telemetry_Send(&sample);
+
+    if (pipeline.camera) {
+        if (captureStatus == OV2640_OK) {
+            printf("  [Camera] Image captured (%lu bytes, QS %u)\r\n", captureLength, OV2640_GetQualityScale());
+        } else if (captureStatus == OV2640_OVERRUN) {
+            printf("  [Camera] Image too large, dropped (QS now %u)\r\n", OV2640_GetQualityScale());
+        } else {
+            printf("  [Camera] Capture failed (code: %d)\r\n", captureStatus);
+        }
+    }
+
+#ifdef SCAN_ADAPTIVE
+    /* Next stop: coarse pass, then bisect range edges while the budget lasts */
+    ScanPlan_Record(&plan, panAngle, sample.distance_mm,
+                    (sample.flags & TELEMETRY_FLAG_RANGE_VALID) != 0U);
+    if (!ScanPlan_Next(&plan, panAngle, HAL_GetTick() - planStartTick, &panAngle)) {
+        printf("\r\n--- Scan cycle complete (%u stops in %lu ms), restarting ---\r\n\r\n",
+               plan.count, HAL_GetTick() - planStartTick);
+        ScanPlan_Reset(&plan);
+        planStartTick = HAL_GetTick();
+        ScanPlan_Next(&plan, panAngle, 0, &panAngle);
+    }
+#else
+    /* Next stop (0 to 180 degrees) */
+    panAngle += SCAN_PAN_STEP_DEG;
+    if (panAngle > 180.0f) {
+        panAngle = 0.0f;
+        printf("\r\n--- Scan cycle complete, restarting ---\r\n\r\n");
+    }
+#endif
+}
+
+/**
+ * @brief  Start the moves to the current stop
+ * @retval None
+ * @note   Arms EVENT_SCAN_ARRIVED for the predicted arrival.
+ */
+static void ScanPipeline_Move(void)
+{
+    Motion_MoveTo(SERVO_PAN_CHANNEL, panAngle);
+    Motion_MoveTo(SERVO_TILT_CHANNEL, SCAN_TILT_DEG);
+    Event_StartTimer(EVENT_SCAN_ARRIVED, Motion_GetWaitTime_ms(), 0);
+}
+
+/**
+ * @brief  Run the stages once
+ * @param  events: SCAN_EV_* completions carried by the current event
+ * @retval None
+ */
+static void ScanPipeline_Run(uint32_t events)
+{
+    /* Completions sampled from the drivers */
+    if (Motion_Arrived(SERVO_PAN_CHANNEL) && Motion_Arrived(SERVO_TILT_CHANNEL)) {
+        events |= SCAN_EV_ARRIVED;
+    }
+    /* Free buffers too small for the current format don't count: with the
+     * large buffer on the wire the capture has to wait for it */
+    if (FramePool_HasFree(OV2640_GetFrameSizeHint(OV2640_GetFormat()))) {
+        events |= SCAN_EV_BUFFER_FREE;
+    }
+    if (pipeline.capture == SCAN_STAGE_BUSY && ScanPipeline_CaptureFinished()) {
+        events |= SCAN_EV_FRAME_DONE;
+    }
+    if (FramePool_Count(FRAME_READY) > 0U && !SerialLink_IsBusy()) {
+        events |= SCAN_EV_FRAME_PENDING;
+    }
+
+    uint32_t actions = ScanPipeline_Step(&pipeline, events);
+
+    if ((actions & SCAN_ACT_RANGE_START) != 0U) {
+        HCSR04_ResetFilter(SCAN_RANGER);
+    }
+    if ((actions & SCAN_ACT_CAPTURE_START) != 0U) {
+        ScanPipeline_StartCapture();
+    }
+    if ((actions & SCAN_ACT_REPORT) != 0U) {
+        ScanPipeline_Report();
+    }
+    if ((actions & SCAN_ACT_MOVE) != 0U) {
+        ScanPipeline_Move();
+    }
+    if ((actions & SCAN_ACT_TX_START) != 0U) {
+        ScanPipeline_StartTransfer();
+    }
+}
+
+/**
+ * @brief  Event handler of all pipeline events
+ * @param  event: Event that fired
+ * @retval None
+ */
+static void ScanPipeline_OnEvent(const Event_t *event)
+{
+    uint32_t events = 0;
+
+    if (event->id == EVENT_RANGE_DONE) {
+        if (event->arg != SCAN_RANGER) {
+            return;
+        }
+        events = SCAN_EV_RANGE;
+    } else if (event->id == EVENT_TX_DONE) {
+        events = SCAN_EV_TX_DONE;
+    }
+
+    /* Arrival, frame end and timeout are picked up from the drivers */
+    ScanPipeline_Run(events);
+}
+
+/**
+ * @brief  Start the scan pipeline
+ * @param  camera: Capture a frame at each stop
+ * @param  ranger: Range at each stop (sensor 0, continuous mode running)
+ * @retval None
+ * @note   Call after Event_Init(), Motion_Init(), HCSR04_StartContinuous()
+ *         and the camera init. Range samples reach the pipeline as
+ *         EVENT_RANGE_DONE (see HCSR04_SetCallback() in main.c).
+ */
+void ScanPipeline_Start(bool camera, bool ranger)
+{
+    ScanPipeline_Reset(&pipeline, camera, ranger);
+    panAngle = 0.0f;
+#ifdef SCAN_ADAPTIVE
+    ScanPlan_Reset(&plan);
+    planStartTick = HAL_GetTick();
+    ScanPlan_Next(&plan, panAngle, 0, &panAngle);
+#endif
+
+    Event_Subscribe(EVENT_RANGE_DONE, ScanPipeline_OnEvent);
+    Event_Subscribe(EVENT_FRAME_DONE, ScanPipeline_OnEvent);
+    Event_Subscribe(EVENT_TX_DONE, ScanPipeline_OnEvent);
+    Event_Subscribe(EVENT_SCAN_ARRIVED, ScanPipeline_OnEvent);
+    Event_Subscribe(EVENT_CAPTURE_TIMEOUT, ScanPipeline_OnEvent);
+
+    /* First step: move to the first stop */
+    ScanPipeline_Run(0);
+}
+
+/**
+ * @brief  Initialize the pipeline state (pure calculation for testing)
+ * @param  pipe: Pipeline state
+ * @param  camera: Capture stage enabled
+ * @param  ranger: Range stage enabled
+ * @retval None
+ * @note   The first step issues the move to the first stop.
+ */
+void ScanPipeline_Reset(ScanPipeline_t *pipe, bool camera, bool ranger)
+{
+    pipe->motion = SCAN_STAGE_IDLE;
+    pipe->range = SCAN_STAGE_IDLE;
+    pipe->capture = SCAN_STAGE_IDLE;
+    pipe->transmit = SCAN_STAGE_IDLE;
+    pipe->rangeCount = 0;
+    pipe->camera = camera;
+    pipe->ranger = ranger;
+}
+
+/**
+ * @brief  Advance all stages by one batch of events (pure calculation for testing)
+ * @param  pipe: Pipeline state
+ * @param  events: SCAN_EV_* bits collected since the last step
+ * @retval SCAN_ACT_* bits to execute
+ * @note   Range samples completing in the step that reports the arrival
+ *         were taken on the move and are not counted. The transmit stage
+ *         only depends on frames being ready, so it overlaps the moves.
+ */
+uint32_t ScanPipeline_Step(ScanPipeline_t *pipe, uint32_t events)
+{
+    uint32_t actions = 0;
+
+    /* Gimbal stage */
+    if (pipe->motion == SCAN_STAGE_IDLE) {
+        pipe->motion = SCAN_STAGE_BUSY;
+        actions |= SCAN_ACT_MOVE;
+    } else if (pipe->motion == SCAN_STAGE_BUSY && (events & SCAN_EV_ARRIVED) != 0U) {
+        pipe->motion = SCAN_STAGE_DONE;
+        pipe->rangeCount = 0;
+        if (pipe->ranger) {
+            pipe->range = SCAN_STAGE_BUSY;
+            actions |= SCAN_ACT_RANGE_START;
+        } else {
+            pipe->range = SCAN_STAGE_DONE;
+        }
+        pipe->capture = pipe->camera ? SCAN_STAGE_WAITING : SCAN_STAGE_DONE;
+    }
+
+    if (pipe->motion == SCAN_STAGE_DONE) {
+        /* Range stage */
+        if (pipe->range == SCAN_STAGE_BUSY && (events & SCAN_EV_RANGE) != 0U &&
+            (actions & SCAN_ACT_RANGE_START) == 0U) {
+            if (++pipe->rangeCount >= SCAN_RANGE_SAMPLES) {
+                pipe->range = SCAN_STAGE_DONE;
+            }
+        }
+
+        /* Capture stage, held back while every buffer is queued or on the wire */
+        if (pipe->capture == SCAN_STAGE_WAITING && (events & SCAN_EV_BUFFER_FREE) != 0U) {
+            pipe->capture = SCAN_STAGE_BUSY;
+            actions |= SCAN_ACT_CAPTURE_START;
+        } else if (pipe->capture == SCAN_STAGE_BUSY && (events & SCAN_EV_FRAME_DONE) != 0U) {
+            pipe->capture = SCAN_STAGE_DONE;
+        }
+
+        /* Stop measured: report it and move on */
+        if (pipe->range == SCAN_STAGE_DONE && pipe->capture == SCAN_STAGE_DONE) {
+            pipe->motion = SCAN_STAGE_BUSY;
+            pipe->range = SCAN_STAGE_IDLE;
+            pipe->capture = SCAN_STAGE_IDLE;
+            actions |= SCAN_ACT_REPORT | SCAN_ACT_MOVE;
+        }
+    }
+
+    /* Transmit stage */
+    if ((events & SCAN_EV_TX_DONE) != 0U) {
+        pipe->transmit = SCAN_STAGE_IDLE;
+    }
+    if (pipe->transmit == SCAN_STAGE_IDLE && (events & SCAN_EV_FRAME_PENDING) != 0U) {
+        pipe->transmit = SCAN_STAGE_BUSY;
+        actions |= SCAN_ACT_TX_START;
+    }
+
+    return actions;
+}
@@ -0,0 +1,145 @@
+/**
+ ******************************************************************************
+ * @file    scan_planner.c
+ * @brief   Adaptive pan stop planner: coarse pass, then bisection of range
+ *          discontinuities within a time budget
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    A sweep starts with the fixed coarse stops (every 30 degrees),
+ *          run from the end nearer the gimbal. Afterwards each new stop
+ *          bisects a pair of neighbouring stops whose ranges jump: an
+ *          object edge is narrowed down to SCAN_PLAN_FINE_DEG, a flat wall
+ *          keeps the coarse spacing. Of the pairs left, the one closest to
+ *          the gimbal is taken, so the servo moves little between refining
+ *          stops.
+ *
+ *          Refinement stops while one more stop, at the average cost of
+ *          the stops so far (move + settle + measure), would overrun
+ *          SCAN_PLAN_BUDGET_MS. The coarse pass always completes.
+ ******************************************************************************
+ */
+
+#include "scan_planner.h"
+#include <math.h>
+
+/* Coarse stops per sweep, both ends included */
+#define SCAN_PLAN_COARSE_COUNT  ((uint8_t)((SCAN_PLAN_MAX_DEG - SCAN_PLAN_MIN_DEG) / SCAN_PLAN_COARSE_DEG) + 1U)
+
+/**
+ * @brief  Check two neighbouring stops for a range discontinuity
+ * @param  a: First stop
+ * @param  b: Second stop
+ * @retval true if only one has an echo or their ranges differ by more than
+ *         SCAN_PLAN_EDGE_MM
+ */
+static bool ScanPlan_IsEdge(const ScanPoint_t *a, const ScanPoint_t *b)
+{
+    if (a->valid != b->valid) {
+        return true;
+    }
+    if (!a->valid) {
+        return false;   // Nothing in range on either side
+    }
+
+    int32_t jump = (int32_t)a->distance_mm - (int32_t)b->distance_mm;
+    return (uint32_t)(jump < 0 ? -jump : jump) > SCAN_PLAN_EDGE_MM;
+}
+
+/**
+ * @brief  Start a new sweep (pure calculation for testing)
+ * @param  plan: Plan state
+ * @retval None
+ */
+void ScanPlan_Reset(ScanPlan_t *plan)
+{
+    plan->count = 0;
+    plan->coarseNext = 0;
+    plan->descending = false;
+}
+
+/**
+ * @brief  Store the result of a stop (pure calculation for testing)
+ * @param  plan: Plan state
+ * @param  angle: Pan angle of the stop
+ * @param  distance_mm: Measured range
+ * @param  valid: An echo was received
+ * @retval None
+ * @note   Stops are kept sorted by angle; a stop at an angle already in the
+ *         table replaces it. Ignored once the table is full.
+ */
+void ScanPlan_Record(ScanPlan_t *plan, float angle, uint16_t distance_mm, bool valid)
+{
+    uint8_t pos = 0;
+
+    while (pos < plan->count && plan->points[pos].angle < angle) {
+        pos++;
+    }
+
+    if (pos == plan->count || plan->points[pos].angle != angle) {
+        if (plan->count >= SCAN_PLAN_MAX_POINTS) {
+            return;
+        }
+        for (uint8_t i = plan->count; i > pos; i--) {
+            plan->points[i] = plan->points[i - 1U];
+        }
+        plan->count++;
+    }
+
+    plan->points[pos].angle = angle;
+    plan->points[pos].distance_mm = distance_mm;
+    plan->points[pos].valid = valid;
+}
+
+/**
+ * @brief  Choose the next stop of the sweep (pure calculation for testing)
+ * @param  plan: Plan state
+ * @param  current: Current pan angle (start of the move)
+ * @param  elapsed_ms: Time since the sweep started
+ * @param  angle: Receives the next stop
+ * @retval false if the sweep is complete (no edge left to refine, spacing
+ *         at SCAN_PLAN_FINE_DEG, budget or table exhausted)
+ */
+bool ScanPlan_Next(ScanPlan_t *plan, float current, uint32_t elapsed_ms, float *angle)
+{
+    /* Coarse pass, starting from the end nearer the gimbal */
+    if (plan->coarseNext < SCAN_PLAN_COARSE_COUNT) {
+        if (plan->coarseNext == 0U) {
+            plan->descending = current > (SCAN_PLAN_MIN_DEG + SCAN_PLAN_MAX_DEG) / 2.0f;
+        }
+
+        float offset = (float)plan->coarseNext * SCAN_PLAN_COARSE_DEG;
+        *angle = plan->descending ? SCAN_PLAN_MAX_DEG - offset : SCAN_PLAN_MIN_DEG + offset;
+        plan->coarseNext++;
+        return true;
+    }
+
+    /* Refine only while one more average stop fits in the budget */
+    if (plan->count == 0U || plan->count >= SCAN_PLAN_MAX_POINTS) {
+        return false;
+    }
+    if (elapsed_ms + elapsed_ms / plan->count > SCAN_PLAN_BUDGET_MS) {
+        return false;
+    }
+
+    bool found = false;
+    float bestTravel = 0.0f;
+
+    for (uint8_t i = 0; i + 1U < plan->count; i++) {
+        const ScanPoint_t *a = &plan->points[i];
+        const ScanPoint_t *b = &plan->points[i + 1U];
+        float mid = (a->angle + b->angle) * 0.5f;
+
+        if (mid - a->angle < SCAN_PLAN_FINE_DEG || !ScanPlan_IsEdge(a, b)) {
+            continue;
+        }
+
+        float travel = fabsf(mid - current);
+        if (!found || travel < bestTravel) {
+            found = true;
+            bestTravel = travel;
+            *angle = mid;
+        }
+    }
+
+    return found;
+}
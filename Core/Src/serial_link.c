@@ -0,0 +1,409 @@
+/**
+ ******************************************************************************
+ * @file    serial_link.c
+ * @brief   USART1 DMA transmit link for log text and image data
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    USART1_TX uses DMA2 Stream7 Channel 4 and carries two sources:
+ *          - Log: printf text and telemetry packets are copied into a ring
+ *            buffer (single producer: main loop, single consumer: DMA
+ *            complete interrupt) and drained in contiguous DMA segments.
+ *          - Bulk transfers: cut into PACKET_IMAGE_CHUNK_SIZE pieces, each
+ *            encoded as a packet into a staging buffer just before it is
+ *            sent. The caller's buffer must stay untouched until the
+ *            callback has run.
+ *          The log always goes first at a chunk boundary, so telemetry waits
+ *          behind at most one image chunk instead of a whole frame.
+ *
+ *          USART1_RX: each byte is taken from DR by the RXNE interrupt and
+ *          pushed into an SPSC ring (ring_buffer.c); the main loop pops it.
+ ******************************************************************************
+ */
+
+#include "serial_link.h"
+#include "usart.h"
+#include "packet.h"
+#include "ring_buffer.h"
+
+#if (SERIAL_LINK_LOG_SIZE & (SERIAL_LINK_LOG_SIZE - 1U)) != 0U
+#error "SERIAL_LINK_LOG_SIZE must be a power of two"
+#endif
+
+#define SERIAL_LINK_LOG_MASK    (SERIAL_LINK_LOG_SIZE - 1U)
+
+/* Largest bulk packet on the wire */
+#define SERIAL_LINK_PACKET_SIZE PACKET_WIRE_SIZE(PACKET_IMAGE_HEADER_SIZE + PACKET_IMAGE_CHUNK_SIZE)
+
+/* What the DMA is currently sending */
+typedef enum {
+    TX_IDLE = 0,
+    TX_LOG,
+    TX_BULK
+} TxMode_t;
+
+/* Private variables - log ring (indices are free running) */
+static uint8_t logBuffer[SERIAL_LINK_LOG_SIZE];
+static volatile uint32_t logHead = 0;       // Written by producer only
+static volatile uint32_t logTail = 0;       // Written by consumer only
+static uint32_t logInFlight = 0;
+static volatile uint32_t logDropped = 0;
+static volatile SerialLink_Policy_t logPolicy = SERIAL_LINK_LOG_POLICY;
+
+/* Private variables - bulk transfer */
+static uint8_t txPacket[SERIAL_LINK_PACKET_SIZE];
+static const uint8_t *txData = NULL;
+static uint32_t txLength = 0;
+static uint32_t txOffset = 0;
+static uint32_t txChunk = 0;
+static uint8_t txChannel = 0;
+static uint16_t txId = 0;
+static SerialLink_TxCallback_t txCallback = NULL;
+static volatile bool bulkBusy = false;      // Submitted or on the wire
+static volatile TxMode_t txMode = TX_IDLE;
+
+/* Private variables - receive ring */
+static uint8_t rxStorage[SERIAL_LINK_RX_SIZE];
+static Ring_t rxRing;
+
+static void SerialLink_AbortCurrent(void);
+
+/**
+ * @brief  Encode the next bulk chunk into the staging buffer
+ * @param  None
+ * @retval Packet length on the wire
+ */
+static uint16_t SerialLink_EncodeChunk(void)
+{
+    Packet_Encoder_t encoder;
+    uint8_t header[PACKET_IMAGE_HEADER_SIZE] = {
+        (uint8_t)txId, (uint8_t)(txId >> 8),
+        (uint8_t)txOffset, (uint8_t)(txOffset >> 8),
+        (uint8_t)(txOffset >> 16), (uint8_t)(txOffset >> 24),
+        (uint8_t)txLength, (uint8_t)(txLength >> 8),
+        (uint8_t)(txLength >> 16), (uint8_t)(txLength >> 24)
+    };
+
+    txChunk = txLength - txOffset;
+    if (txChunk > PACKET_IMAGE_CHUNK_SIZE) {
+        txChunk = PACKET_IMAGE_CHUNK_SIZE;
+    }
+
+    Packet_Begin(&encoder, txPacket, txChannel, (uint16_t)(sizeof(header) + txChunk));
+    Packet_Append(&encoder, header, sizeof(header));
+    Packet_Append(&encoder, &txData[txOffset], txChunk);
+
+    return (uint16_t)Packet_End(&encoder);
+}
+
+/**
+ * @brief  Start the next DMA transfer if the link is idle
+ * @param  None
+ * @retval None
+ * @note   Must run with interrupts masked or from the DMA/UART interrupt.
+ *         Pending log bytes always go before the next bulk chunk.
+ */
+static void SerialLink_Kick(void)
+{
+    uint32_t available;
+
+    if (txMode != TX_IDLE) {
+        return;
+    }
+
+    available = logHead - logTail;
+
+    if (available == 0) {
+        if (bulkBusy && txOffset < txLength) {
+            txMode = TX_BULK;
+            if (HAL_UART_Transmit_DMA(&huart1, txPacket, SerialLink_EncodeChunk()) != HAL_OK) {
+                SerialLink_AbortCurrent();
+            }
+        }
+        return;
+    }
+
+    /* Send up to the end of the ring, the wrapped part follows next time */
+    uint32_t index = logTail & SERIAL_LINK_LOG_MASK;
+    logInFlight = SERIAL_LINK_LOG_SIZE - index;
+    if (logInFlight > available) {
+        logInFlight = available;
+    }
+
+    txMode = TX_LOG;
+    if (HAL_UART_Transmit_DMA(&huart1, &logBuffer[index], (uint16_t)logInFlight) != HAL_OK) {
+        txMode = TX_IDLE;
+    }
+}
+
+/**
+ * @brief  Kick the DMA from thread context
+ * @param  None
+ * @retval None
+ */
+static void SerialLink_KickSafe(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    SerialLink_Kick();
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Finish the current bulk transfer and notify the owner
+ * @param  None
+ * @retval None
+ */
+static void SerialLink_CompleteBulk(void)
+{
+    SerialLink_TxCallback_t callback = txCallback;
+
+    txCallback = NULL;
+    txOffset = 0;
+    txLength = 0;
+    bulkBusy = false;
+
+    if (callback != NULL) {
+        callback();
+    }
+}
+
+/**
+ * @brief  Queue a buffer as a chunked packet stream (non-blocking)
+ * @param  channel: PACKET_CHANNEL_* carried by every chunk
+ * @param  id: Transfer id carried by every chunk (e.g. frame sequence)
+ * @param  data: Data to send (must remain valid until completion)
+ * @param  length: Number of bytes
+ * @param  callback: Called from interrupt context when done (may be NULL)
+ * @retval SERIAL_LINK_OK, SERIAL_LINK_BUSY if a transfer is already queued
+ */
+SerialLink_Status_t SerialLink_SendAsync(uint8_t channel, uint16_t id, const uint8_t *data,
+                                         uint32_t length, SerialLink_TxCallback_t callback)
+{
+    if (bulkBusy) {
+        return SERIAL_LINK_BUSY;
+    }
+
+    if (length == 0) {
+        if (callback != NULL) {
+            callback();
+        }
+        return SERIAL_LINK_OK;
+    }
+
+    txChannel = channel;
+    txId = id;
+    txData = data;
+    txLength = length;
+    txOffset = 0;
+    txCallback = callback;
+    bulkBusy = true;
+
+    SerialLink_KickSafe();
+
+    return SERIAL_LINK_OK;
+}
+
+/**
+ * @brief  Check whether a bulk transfer is queued or in progress
+ * @param  None
+ * @retval true if busy
+ */
+bool SerialLink_IsBusy(void)
+{
+    return bulkBusy;
+}
+
+/**
+ * @brief  Block until all queued log text and bulk data has been sent
+ * @param  None
+ * @retval None
+ */
+void SerialLink_WaitIdle(void)
+{
+    while (bulkBusy || (logHead != logTail) || txMode != TX_IDLE) {
+        SerialLink_KickSafe();
+    }
+}
+
+/**
+ * @brief  Copy log text into the ring buffer and start draining it
+ * @param  data: Bytes to send
+ * @param  length: Number of bytes
+ * @retval Number of bytes queued (less than length if bytes were dropped)
+ * @note   Main loop only. In interrupt context the DROP policy always
+ *         applies, since waiting there could never complete.
+ */
+uint32_t SerialLink_Write(const uint8_t *data, uint32_t length)
+{
+    bool canBlock = (logPolicy == SERIAL_LINK_POLICY_BLOCK) && (__get_IPSR() == 0U);
+    uint32_t written = 0;
+
+    while (written < length) {
+        uint32_t head = logHead;
+        uint32_t space = SERIAL_LINK_LOG_SIZE - (head - logTail);
+
+        if (space == 0) {
+            if (!canBlock) {
+                logDropped += length - written;
+                break;
+            }
+            SerialLink_KickSafe();
+            continue;
+        }
+
+        /* Copy up to the end of the ring in one go */
+        uint32_t index = head & SERIAL_LINK_LOG_MASK;
+        uint32_t count = SERIAL_LINK_LOG_SIZE - index;
+        if (count > space) {
+            count = space;
+        }
+        if (count > length - written) {
+            count = length - written;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            logBuffer[index + i] = data[written + i];
+        }
+
+        /* Publish the bytes before moving the head */
+        __DMB();
+        logHead = head + count;
+        written += count;
+    }
+
+    SerialLink_KickSafe();
+
+    return written;
+}
+
+/**
+ * @brief  Select what happens when the log ring buffer is full
+ * @param  policy: SERIAL_LINK_POLICY_BLOCK or SERIAL_LINK_POLICY_DROP
+ * @retval None
+ */
+void SerialLink_SetLogPolicy(SerialLink_Policy_t policy)
+{
+    logPolicy = policy;
+}
+
+/**
+ * @brief  Get the number of log bytes dropped because the ring was full
+ * @param  None
+ * @retval Dropped byte count since boot
+ */
+uint32_t SerialLink_GetLogDropped(void)
+{
+    return logDropped;
+}
+
+/**
+ * @brief  UART transmit complete handler
+ * @param  None
+ * @retval None
+ * @note   This should be called from HAL_UART_TxCpltCallback in stm32f4xx_it.c
+ */
+void SerialLink_TxCpltCallback(void)
+{
+    if (txMode == TX_LOG) {
+        logTail += logInFlight;
+        logInFlight = 0;
+        txMode = TX_IDLE;
+    } else if (txMode == TX_BULK) {
+        txOffset += txChunk;
+        txMode = TX_IDLE;
+
+        if (txOffset >= txLength) {
+            SerialLink_CompleteBulk();
+        }
+    }
+
+    SerialLink_Kick();
+}
+
+/**
+ * @brief  Abandon the current segment so waiters are released
+ * @param  None
+ * @retval None
+ */
+static void SerialLink_AbortCurrent(void)
+{
+    if (txMode == TX_LOG) {
+        logTail += logInFlight;
+        logInFlight = 0;
+    } else if (txMode == TX_BULK) {
+        SerialLink_CompleteBulk();
+    }
+
+    txMode = TX_IDLE;
+    SerialLink_Kick();
+}
+
+/**
+ * @brief  UART error handler
+ * @param  None
+ * @retval None
+ * @note   This should be called from HAL_UART_ErrorCallback in stm32f4xx_it.c.
+ *         Only TX DMA errors concern the link.
+ */
+void SerialLink_ErrorCallback(void)
+{
+    if ((huart1.ErrorCode & HAL_UART_ERROR_DMA) != 0U) {
+        SerialLink_AbortCurrent();
+    }
+}
+
+/**
+ * @brief  Start receiving into the receive ring
+ * @param  None
+ * @retval None
+ * @note   Call once after MX_USART1_UART_Init().
+ */
+void SerialLink_StartReceive(void)
+{
+    Ring_Init(&rxRing, rxStorage, 1U, SERIAL_LINK_RX_SIZE);
+    __HAL_UART_ENABLE_IT(&huart1, UART_IT_RXNE);
+}
+
+/**
+ * @brief  Take the oldest received byte
+ * @param  byte: Receives the byte
+ * @retval false if nothing has been received
+ * @note   Main loop only (single consumer).
+ */
+bool SerialLink_ReadByte(uint8_t *byte)
+{
+    return Ring_Pop(&rxRing, byte);
+}
+
+/**
+ * @brief  Get the number of received bytes lost because the ring was full
+ * @param  None
+ * @retval Dropped byte count since SerialLink_StartReceive()
+ */
+uint32_t SerialLink_GetRxDropped(void)
+{
+    return rxRing.dropped;
+}
+
+/**
+ * @brief  USART1 receive handler
+ * @param  None
+ * @retval None
+ * @note   This should be called from USART1_IRQHandler before
+ *         HAL_UART_IRQHandler(). Reading SR then DR also clears a pending
+ *         overrun/noise/framing error, which HAL would otherwise report
+ *         as a link error.
+ */
+void SerialLink_RxIrqHandler(void)
+{
+    uint32_t sr = huart1.Instance->SR;
+
+    if ((sr & (USART_SR_RXNE | USART_SR_ORE | USART_SR_NE | USART_SR_FE)) != 0U) {
+        uint8_t byte = (uint8_t)huart1.Instance->DR;
+
+        if ((sr & USART_SR_RXNE) != 0U) {
+            Ring_Push(&rxRing, &byte);
+        }
+    }
+}
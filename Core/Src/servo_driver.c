@@ -8,6 +8,10 @@
 
 #include "servo_driver.h"
 #include "tim.h"
+#include "timebase.h"
+
+/* Timebase of the last pulse update per channel (pan, tilt) */
+static uint32_t commandTime_us[2];
 
 /**
  * @brief  Initialize servo motors (start PWM channels)
@@ -71,4 +75,16 @@ void Servo_SetPulse(uint32_t channel, uint16_t pulse)
 
     /* Update PWM compare value */
     __HAL_TIM_SET_COMPARE(&htim4, channel, pulse);
+    commandTime_us[(channel == SERVO_TILT_CHANNEL) ? 1 : 0] = Timebase_Now();
+}
+
+/**
+ * @brief  Time of the last command sent to a servo
+ * @param  channel: TIM_CHANNEL_1 (Pan) or TIM_CHANNEL_2 (Tilt)
+ * @retval Timebase in microseconds of the last Servo_SetPulse()
+ * @note   The new pulse takes effect at the next 20ms PWM period.
+ */
+uint32_t Servo_GetCommandTime(uint32_t channel)
+{
+    return commandTime_us[(channel == SERVO_TILT_CHANNEL) ? 1 : 0];
 }
@@ -0,0 +1,414 @@
+/**
+ ******************************************************************************
+ * @file    servo_motion.c
+ * @brief   Trapezoidal servo trajectories on top of servo_driver with
+ *          arrival-time prediction
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    TIM4 (servo PWM, 50Hz) update interrupt advances each axis by one
+ *          setpoint per PWM frame: accelerate at MOTION_ACCEL_DPS2 up to
+ *          MOTION_MAX_SPEED_DPS, brake so the last setpoint lands on the
+ *          target. The CCR preload makes each setpoint take effect at the
+ *          start of the next frame.
+ *
+ *          Every move gets a predicted arrival time on the shared timebase
+ *          (closed-form trapezoid time + update phase + CCR preload +
+ *          MOTION_SETTLE_MS), computed outside the critical section,
+ *          so callers wait only as long as the step needs instead of a
+ *          fixed delay.
+ *
+ *          The setpoints are also logged with the time they reach the PWM
+ *          output, so a measurement stamped on the timebase can be tagged
+ *          with the angle commanded at that instant (Motion_AngleAt), e.g.
+ *          while sweeping at constant speed (Motion_Sweep).
+ ******************************************************************************
+ */
+
+#include "servo_motion.h"
+#include "servo_driver.h"
+#include "tim.h"
+#include "timebase.h"
+#include <math.h>
+
+#if (MOTION_HISTORY_LEN & (MOTION_HISTORY_LEN - 1U)) != 0U
+#error "MOTION_HISTORY_LEN must be a power of two"
+#endif
+
+#define MOTION_AXES             2U
+#define MOTION_DT_S             (MOTION_PERIOD_MS / 1000.0f)
+#define MOTION_HISTORY_MASK     (MOTION_HISTORY_LEN - 1U)
+
+/* Private variables, indexed pan = 0, tilt = 1 */
+static Motion_Profile_t profiles[MOTION_AXES];
+static volatile bool moving[MOTION_AXES];
+static volatile uint32_t arrival_us[MOTION_AXES];
+
+/* Commanded trajectory, written by the update ISR and by move commands */
+static Motion_Point_t history[MOTION_AXES][MOTION_HISTORY_LEN];
+static uint32_t historyHead[MOTION_AXES];      // Total points logged
+
+/**
+ * @brief  Axis index of a servo channel
+ * @param  channel: SERVO_PAN_CHANNEL or SERVO_TILT_CHANNEL
+ * @retval 0 (pan) or 1 (tilt)
+ */
+static inline uint32_t Motion_Axis(uint32_t channel)
+{
+    return (channel == SERVO_TILT_CHANNEL) ? 1U : 0U;
+}
+
+/**
+ * @brief  Log a commanded angle
+ * @param  axis: Axis index
+ * @param  time_us: Timebase at which the angle reaches the PWM output
+ * @param  angle: Commanded angle in degrees
+ * @retval None
+ * @note   Called from the update ISR or with interrupts disabled
+ */
+static void Motion_Log(uint32_t axis, uint32_t time_us, float angle)
+{
+    Motion_Point_t *point = &history[axis][historyHead[axis] & MOTION_HISTORY_MASK];
+
+    point->time_us = time_us;
+    point->angle = angle;
+    historyHead[axis]++;
+}
+
+/**
+ * @brief  Start a move with a given cruise speed
+ * @param  axis: Axis index
+ * @param  angle: Target angle in degrees, clamped to 0-180
+ * @param  speed_dps: Cruise speed in deg/s
+ * @retval None
+ */
+static void Motion_Start(uint32_t axis, float angle, float speed_dps)
+{
+    if (angle < 0.0f) angle = 0.0f;
+    if (angle > 180.0f) angle = 180.0f;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t now = Timebase_Now();
+    Motion_Profile_t *profile = &profiles[axis];
+    Motion_Profile_t snapshot;
+
+    /* The output holds the current setpoint until the first new one,
+     * unless the last logged setpoint has not taken effect yet */
+    if (!moving[axis]) {
+        const Motion_Point_t *last = &history[axis][(historyHead[axis] - 1U) & MOTION_HISTORY_MASK];
+        if (historyHead[axis] == 0U || (int32_t)(now - last->time_us) >= 0) {
+            Motion_Log(axis, now, profile->position);
+        }
+    }
+
+    profile->target = angle;
+    profile->maxSpeed = speed_dps;
+    snapshot = *profile;
+    moving[axis] = true;
+
+    __set_PRIMASK(primask);
+
+    /* Predict from the state at 'now', with interrupts enabled */
+    uint32_t arrival = now + Motion_MoveTime_ms(&snapshot) * 1000U;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    arrival_us[axis] = arrival;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief  Start the setpoint generator
+ * @param  None
+ * @retval None
+ * @note   Call after Servo_Init(), which leaves both servos at 90 degrees.
+ */
+void Motion_Init(void)
+{
+    for (uint32_t i = 0; i < MOTION_AXES; i++) {
+        profiles[i].position = 90.0f;
+        profiles[i].velocity = 0.0f;
+        profiles[i].target = 90.0f;
+        profiles[i].maxSpeed = MOTION_MAX_SPEED_DPS;
+        moving[i] = false;
+        historyHead[i] = 0;
+        arrival_us[i] = Timebase_Now();
+    }
+
+    HAL_TIM_Base_Start_IT(&htim4);
+}
+
+/**
+ * @brief  Start a move to a new angle
+ * @param  channel: SERVO_PAN_CHANNEL or SERVO_TILT_CHANNEL
+ * @param  angle: Target angle in degrees (0-180)
+ * @retval None
+ * @note   Non-blocking. A move in progress is re-targeted smoothly.
+ */
+void Motion_MoveTo(uint32_t channel, float angle)
+{
+    Motion_Start(Motion_Axis(channel), angle, MOTION_MAX_SPEED_DPS);
+}
+
+/**
+ * @brief  Sweep to an angle at constant speed
+ * @param  channel: SERVO_PAN_CHANNEL or SERVO_TILT_CHANNEL
+ * @param  angle: End angle in degrees (0-180)
+ * @param  speed_dps: Sweep speed in deg/s, up to MOTION_MAX_SPEED_DPS
+ * @retval None
+ * @note   Non-blocking. Same ramps as Motion_MoveTo(), the cruise phase
+ *         runs at speed_dps. Motion_Arrived() reports the end of the sweep.
+ */
+void Motion_Sweep(uint32_t channel, float angle, float speed_dps)
+{
+    if (speed_dps <= 0.0f || speed_dps > MOTION_MAX_SPEED_DPS) {
+        speed_dps = MOTION_MAX_SPEED_DPS;
+    }
+
+    Motion_Start(Motion_Axis(channel), angle, speed_dps);
+}
+
+/**
+ * @brief  Angle commanded to a servo at a given time
+ * @param  channel: SERVO_PAN_CHANNEL or SERVO_TILT_CHANNEL
+ * @param  time_us: Timebase of the event, e.g. HCSR04_Sample_t.timestamp_us
+ * @param  angle: Receives the angle in degrees
+ * @retval false if time_us is older than the logged trajectory
+ * @note   Linear between setpoints; after the last one the axis is at rest.
+ */
+bool Motion_AngleAt(uint32_t channel, uint32_t time_us, float *angle)
+{
+    uint32_t axis = Motion_Axis(channel);
+    Motion_Point_t points[MOTION_HISTORY_LEN];
+
+    /* Snapshot the ring in chronological order */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t head = historyHead[axis];
+    uint32_t count = (head < MOTION_HISTORY_LEN) ? head : MOTION_HISTORY_LEN;
+    for (uint32_t i = 0; i < count; i++) {
+        points[i] = history[axis][(head - count + i) & MOTION_HISTORY_MASK];
+    }
+
+    __set_PRIMASK(primask);
+
+    if (count == 0U) {
+        *angle = profiles[axis].position;
+        return true;
+    }
+
+    return Motion_Interpolate(points, count, time_us, angle);
+}
+
+/**
+ * @brief  Check whether a servo is expected to be at rest on its target
+ * @param  channel: SERVO_PAN_CHANNEL or SERVO_TILT_CHANNEL
+ * @retval true once the predicted arrival time has passed
+ */
+bool Motion_Arrived(uint32_t channel)
+{
+    return (int32_t)(Timebase_Now() - arrival_us[Motion_Axis(channel)]) >= 0;
+}
+
+/**
+ * @brief  Predicted arrival time of the last move
+ * @param  channel: SERVO_PAN_CHANNEL or SERVO_TILT_CHANNEL
+ * @retval Timebase in microseconds
+ */
+uint32_t Motion_GetArrivalTime(uint32_t channel)
+{
+    return arrival_us[Motion_Axis(channel)];
+}
+
+/**
+ * @brief  Time until both servos are expected to be at rest
+ * @param  None
+ * @retval Milliseconds, rounded up plus one tick so that a HAL tick timer
+ *         of this length never expires early; 0 if both have arrived
+ */
+uint32_t Motion_GetWaitTime_ms(void)
+{
+    uint32_t now = Timebase_Now();
+    int32_t wait_us = 0;
+
+    for (uint32_t i = 0; i < MOTION_AXES; i++) {
+        int32_t left_us = (int32_t)(arrival_us[i] - now);
+        if (left_us > wait_us) {
+            wait_us = left_us;
+        }
+    }
+
+    return (wait_us > 0) ? ((uint32_t)wait_us + 999U) / 1000U + 1U : 0U;
+}
+
+/**
+ * @brief  Setpoint currently commanded to a servo
+ * @param  channel: SERVO_PAN_CHANNEL or SERVO_TILT_CHANNEL
+ * @retval Angle in degrees
+ */
+float Motion_GetSetpoint(uint32_t channel)
+{
+    return profiles[Motion_Axis(channel)].position;
+}
+
+/**
+ * @brief  TIM4 update handler, one setpoint per axis and PWM frame
+ * @param  htim: Timer that raised the update
+ * @retval None
+ * @note   This should be called from HAL_TIM_PeriodElapsedCallback. The
+ *         new compare value is preloaded, it drives the output from the
+ *         next update on.
+ */
+void Motion_UpdateCallback(TIM_HandleTypeDef *htim)
+{
+    static const uint32_t channels[MOTION_AXES] = { SERVO_PAN_CHANNEL, SERVO_TILT_CHANNEL };
+
+    if (htim != &htim4) {
+        return;
+    }
+
+    uint32_t effective = Timebase_Now() + MOTION_PERIOD_MS * 1000U;
+    for (uint32_t i = 0; i < MOTION_AXES; i++) {
+        if (!moving[i]) {
+            continue;
+        }
+        moving[i] = Motion_ProfileStep(&profiles[i], MOTION_DT_S);
+        Servo_SetAngle(channels[i], profiles[i].position);
+        Motion_Log(i, effective, profiles[i].position);
+    }
+}
+
+/**
+ * @brief  Advance a profile by one setpoint (pure calculation for testing)
+ * @param  profile: Profile state
+ * @param  dt: Setpoint period in seconds
+ * @retval true while the setpoint has not reached the target
+ * @note   The speed is capped by the move's cruise speed and by
+ *         sqrt(2 * a * d), the fastest speed that can still brake to rest
+ *         within the remaining distance d. Moving away from the target
+ *         (after a re-target) is braked first.
+ */
+bool Motion_ProfileStep(Motion_Profile_t *profile, float dt)
+{
+    float remaining = profile->target - profile->position;
+    float dir = (remaining >= 0.0f) ? 1.0f : -1.0f;
+    float distance = remaining * dir;
+    float speed = profile->velocity * dir;
+
+    float limit = sqrtf(2.0f * MOTION_ACCEL_DPS2 * distance);
+    if (limit > profile->maxSpeed) {
+        limit = profile->maxSpeed;
+    }
+
+    speed += MOTION_ACCEL_DPS2 * dt;
+    if (speed > limit) {
+        speed = limit;
+    }
+
+    /* Within rounding of the target the sign of 'remaining' is noise:
+     * land instead of braking a motion "away" from it */
+    float step = speed * dt;
+    if (distance <= step + MOTION_LAND_DEG || distance < MOTION_LAND_DEG) {
+        profile->position = profile->target;
+        profile->velocity = 0.0f;
+        return false;
+    }
+
+    profile->position += dir * step;
+    profile->velocity = dir * speed;
+    return true;
+}
+
+/**
+ * @brief  Time from now until a servo is at rest (pure calculation for testing)
+ * @param  profile: Profile state, left unmodified
+ * @retval Milliseconds, 0 if the profile is already at rest on its target
+ * @note   Closed form, constant time: braking a motion away from the target,
+ *         the acceleration ramp, cruise at distance / speed and the braking
+ *         ramp of the continuous trapezoid, rounded up to whole setpoint
+ *         periods. The setpoints gain speed one period early and brake on
+ *         the sqrt(2 * a * d) curve, so they never take longer. Then one
+ *         period for the phase to the next update, one for the CCR preload
+ *         and MOTION_SETTLE_MS.
+ */
+uint32_t Motion_MoveTime_ms(const Motion_Profile_t *profile)
+{
+    const float accel = MOTION_ACCEL_DPS2;
+    float remaining = profile->target - profile->position;
+    float dir = (remaining >= 0.0f) ? 1.0f : -1.0f;
+    float distance = remaining * dir;
+    float speed = profile->velocity * dir;
+    float time = 0.0f;
+
+    if (distance == 0.0f && speed == 0.0f) {
+        return 0U;
+    }
+
+    /* Moving away: brake to rest first, the way back gets longer */
+    if (speed < 0.0f) {
+        time = -speed / accel;
+        distance += speed * speed / (2.0f * accel);
+        speed = 0.0f;
+    }
+
+    /* Faster than the cruise or braking limit: the setpoints cut the speed
+     * down at once */
+    if (speed > profile->maxSpeed) {
+        speed = profile->maxSpeed;
+    }
+    if (speed * speed > 2.0f * accel * distance) {
+        speed = sqrtf(2.0f * accel * distance);
+    }
+
+    /* Peak speed of the trapezoid (or triangle) from here to rest */
+    float peak = sqrtf(accel * distance + 0.5f * speed * speed);
+    if (peak > profile->maxSpeed) {
+        peak = profile->maxSpeed;
+    }
+
+    float ramps = (peak * peak - 0.5f * speed * speed) / accel;
+    time += (2.0f * peak - speed) / accel;
+    if (peak > 0.0f && distance > ramps) {
+        time += (distance - ramps) / peak;
+    }
+
+    /* At least the step that lands on the target */
+    uint32_t steps = (uint32_t)ceilf(time / MOTION_DT_S);
+    if (steps == 0U) {
+        steps = 1U;
+    }
+
+    return (steps + 2U) * MOTION_PERIOD_MS + MOTION_SETTLE_MS;
+}
+
+/**
+ * @brief  Angle on a logged trajectory (pure calculation for testing)
+ * @param  points: Setpoints in chronological order
+ * @param  count: Number of points
+ * @param  time_us: Timebase of the query
+ * @param  angle: Receives the angle in degrees
+ * @retval false if there are no points or time_us precedes the first one
+ * @note   Times are compared by signed difference, so the lookup works
+ *         across the timebase wrap.
+ */
+bool Motion_Interpolate(const Motion_Point_t *points, uint32_t count, uint32_t time_us, float *angle)
+{
+    if (count == 0U || (int32_t)(time_us - points[0].time_us) < 0) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i + 1U < count; i++) {
+        int32_t span = (int32_t)(points[i + 1U].time_us - points[i].time_us);
+        int32_t into = (int32_t)(time_us - points[i].time_us);
+
+        if (into < span) {
+            *angle = points[i].angle + (points[i + 1U].angle - points[i].angle) * (float)into / (float)span;
+            return true;
+        }
+    }
+
+    *angle = points[count - 1U].angle;
+    return true;
+}
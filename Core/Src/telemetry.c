@@ -0,0 +1,144 @@
+/**
+ ******************************************************************************
+ * @file    telemetry.c
+ * @brief   Scan telemetry output: text lines and COBS-framed binary records
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    Binary records go out as PACKET_CHANNEL_TELEMETRY packets (see
+ *          packet.c for framing and CRC). Record layout (little-endian):
+ *            [0] version  [1] flags  [2..3] sequence  [4..7] timestamp_ms
+ *            [8..9] pan_cdeg  [10..11] tilt_cdeg  [12..13] distance_mm
+ ******************************************************************************
+ */
+
+#include "telemetry.h"
+#include "serial_link.h"
+#include "packet.h"
+#include <stdio.h>
+
+/* Private variables */
+static Telemetry_Mode_t telemetryMode = TELEMETRY_DEFAULT_MODE;
+static uint16_t telemetrySequence = 0;
+
+/**
+ * @brief  Serialize a sample into the little-endian record layout
+ * @param  sample: Sample to serialize
+ * @param  sequence: Record sequence number
+ * @param  output: Destination, TELEMETRY_RECORD_SIZE bytes
+ * @retval TELEMETRY_RECORD_SIZE
+ */
+size_t Telemetry_Serialize(const Telemetry_Sample_t *sample, uint16_t sequence, uint8_t *output)
+{
+    output[0] = TELEMETRY_VERSION;
+    output[1] = sample->flags;
+    output[2] = (uint8_t)(sequence);
+    output[3] = (uint8_t)(sequence >> 8);
+    output[4] = (uint8_t)(sample->timestamp_ms);
+    output[5] = (uint8_t)(sample->timestamp_ms >> 8);
+    output[6] = (uint8_t)(sample->timestamp_ms >> 16);
+    output[7] = (uint8_t)(sample->timestamp_ms >> 24);
+    output[8] = (uint8_t)((uint16_t)sample->pan_cdeg);
+    output[9] = (uint8_t)((uint16_t)sample->pan_cdeg >> 8);
+    output[10] = (uint8_t)((uint16_t)sample->tilt_cdeg);
+    output[11] = (uint8_t)((uint16_t)sample->tilt_cdeg >> 8);
+    output[12] = (uint8_t)(sample->distance_mm);
+    output[13] = (uint8_t)(sample->distance_mm >> 8);
+
+    return TELEMETRY_RECORD_SIZE;
+}
+
+/**
+ * @brief  Build a complete telemetry packet
+ * @param  sample: Sample to encode
+ * @param  sequence: Record sequence number
+ * @param  output: Destination, TELEMETRY_FRAME_MAX bytes
+ * @retval Packet length in bytes
+ */
+size_t Telemetry_EncodeFrame(const Telemetry_Sample_t *sample, uint16_t sequence, uint8_t *output)
+{
+    uint8_t record[TELEMETRY_RECORD_SIZE];
+
+    Telemetry_Serialize(sample, sequence, record);
+
+    return Packet_Encode(output, PACKET_CHANNEL_TELEMETRY, record, TELEMETRY_RECORD_SIZE);
+}
+
+/**
+ * @brief  Split a fixed-point value in tenths for printing
+ * @param  tenths: Value in 0.1 units
+ * @param  sign: Receives "-" or ""
+ * @param  whole: Receives the integer part
+ * @param  frac: Receives the tenths digit
+ * @retval None
+ */
+static void Telemetry_SplitTenths(int32_t tenths, const char **sign, long *whole, long *frac)
+{
+    *sign = (tenths < 0) ? "-" : "";
+    if (tenths < 0) {
+        tenths = -tenths;
+    }
+    *whole = tenths / 10;
+    *frac = tenths % 10;
+}
+
+/**
+ * @brief  Print a sample as a human-readable line (integer formatting only)
+ * @param  sample: Sample to print
+ * @retval None
+ */
+static void Telemetry_SendText(const Telemetry_Sample_t *sample)
+{
+    const char *panSign, *tiltSign, *distSign;
+    long panWhole, panFrac, tiltWhole, tiltFrac, distWhole, distFrac;
+
+    Telemetry_SplitTenths(sample->pan_cdeg / 10, &panSign, &panWhole, &panFrac);
+    Telemetry_SplitTenths(sample->tilt_cdeg / 10, &tiltSign, &tiltWhole, &tiltFrac);
+    Telemetry_SplitTenths(sample->distance_mm, &distSign, &distWhole, &distFrac);
+
+    printf("Pan: %s%ld.%ld deg | Tilt: %s%ld.%ld deg | Distance: %s%ld.%ld cm\r\n",
+           panSign, panWhole, panFrac, tiltSign, tiltWhole, tiltFrac,
+           distSign, distWhole, distFrac);
+}
+
+/**
+ * @brief  Select the telemetry output mode at runtime
+ * @param  mode: TELEMETRY_MODE_TEXT, TELEMETRY_MODE_BINARY or TELEMETRY_MODE_BOTH
+ * @retval None
+ */
+void Telemetry_SetMode(Telemetry_Mode_t mode)
+{
+    telemetryMode = mode;
+}
+
+/**
+ * @brief  Get the current telemetry output mode
+ * @param  None
+ * @retval Telemetry_Mode_t
+ */
+Telemetry_Mode_t Telemetry_GetMode(void)
+{
+    return telemetryMode;
+}
+
+/**
+ * @brief  Emit one scan sample in the selected mode
+ * @param  sample: Sample to send
+ * @retval None
+ */
+void Telemetry_Send(const Telemetry_Sample_t *sample)
+{
+    if (telemetryMode != TELEMETRY_MODE_BINARY) {
+        Telemetry_SendText(sample);
+    }
+
+    if (telemetryMode != TELEMETRY_MODE_TEXT) {
+        uint8_t frame[TELEMETRY_FRAME_MAX];
+        size_t length = Telemetry_EncodeFrame(sample, telemetrySequence, frame);
+
+        /* Flush pending printf text first so the frame is not split by it */
+        fflush(stdout);
+        SerialLink_Write(frame, length);
+    }
+
+    telemetrySequence++;
+}
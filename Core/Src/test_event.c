@@ -0,0 +1,148 @@
+/**
+ ******************************************************************************
+ * @file    test_event.c
+ * @brief   Unit tests of the event loop timers and the SPSC ring
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    Only HAL-free modules are tested here, so this file is part of
+ *          the embedded suite (Run_All_Tests) and of the host test build
+ *          (tests/host).
+ ******************************************************************************
+ */
+
+#include "test_suite.h"
+#include "event_loop.h"
+#include "ring_buffer.h"
+#include <string.h>
+
+/* Stress element: the check word detects a torn or misplaced copy */
+typedef struct {
+    uint32_t sequence;
+    uint32_t check;         // ~sequence
+    uint16_t tag;           // Low half of sequence
+} Test_RingRecord_t;
+
+/**
+ * @brief  Test SPSC ring: order, overflow, index wrap and interleaved stress
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_Ring(void)
+{
+    static Test_RingRecord_t records[8];
+    static uint8_t bytes[4];
+    Test_RingRecord_t record;
+    Ring_t ring;
+    uint8_t byte;
+
+    /* Test 1: Capacity must be a power of two */
+    TEST_ASSERT(!Ring_Init(&ring, bytes, 1, 3), "Capacity 3 should be rejected");
+    TEST_ASSERT(!Ring_Init(&ring, bytes, 0, 4), "Element size 0 should be rejected");
+    TEST_ASSERT(Ring_Init(&ring, bytes, 1, 4), "Capacity 4 should be accepted");
+
+    /* Test 2: Byte ring keeps order, refuses the fifth byte and counts it */
+    for (uint8_t i = 0; i < 5U; i++) {
+        TEST_ASSERT_EQUAL(i < 4U, Ring_Push(&ring, &i), "Only four bytes should fit");
+    }
+    TEST_ASSERT_EQUAL(4, Ring_Count(&ring), "Ring should be full");
+    TEST_ASSERT_EQUAL(1, ring.dropped, "Refused byte should be counted");
+    for (uint8_t i = 0; i < 4U; i++) {
+        TEST_ASSERT(Ring_Pop(&ring, &byte) && byte == i, "Bytes should pop in order");
+    }
+    TEST_ASSERT(!Ring_Pop(&ring, &byte), "Empty ring should pop nothing");
+
+    /* Test 3: Interleaved bursts of a 10-byte record across the index wrap.
+     * The producer pushes until it meets a full ring; every record that was
+     * accepted must come out once, in order and intact. */
+    TEST_ASSERT(Ring_Init(&ring, records, sizeof(Test_RingRecord_t), 8), "Record ring init");
+    ring.head = 0xFFFFFF00U;
+    ring.tail = 0xFFFFFF00U;
+
+    uint32_t seed = 12345U;
+    uint32_t produced = 0;
+    uint32_t accepted = 0;
+    uint32_t consumed = 0;
+    for (uint32_t round = 0; round < 2000U; round++) {
+        seed = seed * 1664525U + 1013904223U;
+        uint32_t pushes = (seed >> 16) % 11U;
+        uint32_t pops = (seed >> 8) % 11U;
+
+        for (uint32_t i = 0; i < pushes; i++) {
+            record.sequence = produced;
+            record.check = ~produced;
+            record.tag = (uint16_t)produced;
+            produced++;
+            if (Ring_Push(&ring, &record)) {
+                accepted++;
+            }
+        }
+        TEST_ASSERT(Ring_Count(&ring) <= 8U, "Fill level should never exceed capacity");
+
+        for (uint32_t i = 0; i < pops && Ring_Pop(&ring, &record); i++) {
+            TEST_ASSERT(record.check == ~record.sequence && record.tag == (uint16_t)record.sequence,
+                        "Record should not be torn");
+            TEST_ASSERT(record.sequence >= consumed, "Records should pop in order");
+            consumed = record.sequence + 1U;
+        }
+    }
+    while (Ring_Pop(&ring, &record)) {
+        consumed = record.sequence + 1U;
+    }
+    TEST_ASSERT(ring.head < 0xFFFFFF00U, "Indices should have wrapped");
+    TEST_ASSERT_EQUAL(produced, accepted + ring.dropped, "Every push is either accepted or counted");
+    TEST_ASSERT_EQUAL(accepted, ring.tail - 0xFFFFFF00U, "Every accepted record should be popped");
+
+    /* Test 4: Discard empties the ring */
+    Ring_Push(&ring, &record);
+    Ring_Discard(&ring);
+    TEST_ASSERT_EQUAL(0, Ring_Count(&ring), "Discard should empty the ring");
+
+    return true;
+}
+
+/**
+ * @brief  Test event queue and software timers
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_EventLoop(void)
+{
+    static Event_t storage[EVENT_QUEUE_SIZE];
+    Ring_t queue;
+    EventTimer_t timers[2];
+    Event_t event;
+
+    /* Test 1: One-shot timer fires once, on time, across the tick wrap */
+    Ring_Init(&queue, storage, sizeof(Event_t), EVENT_QUEUE_SIZE);
+    memset(timers, 0, sizeof(timers));
+    TEST_ASSERT(EventTimer_Arm(timers, 2, EVENT_SCAN_ARRIVED, 0xFFFFFFF0U, 0x20U, 0), "Arm should succeed");
+    TEST_ASSERT_EQUAL(0, EventTimer_Expire(timers, 2, 0x0000000FU, &queue), "Timer should not fire early");
+    TEST_ASSERT_EQUAL(1, EventTimer_Expire(timers, 2, 0x00000010U, &queue), "Timer should fire when due");
+    TEST_ASSERT(Ring_Pop(&queue, &event) && event.id == EVENT_SCAN_ARRIVED, "Expiry should post its event");
+    TEST_ASSERT_EQUAL(0, EventTimer_Expire(timers, 2, 0x00000100U, &queue), "One-shot timer should fire once");
+
+    /* Test 2: Periodic timer keeps its phase; re-arming reuses the entry */
+    TEST_ASSERT(EventTimer_Arm(timers, 2, EVENT_CAPTURE_TIMEOUT, 1000U, 100U, 100U), "Arm periodic");
+    TEST_ASSERT_EQUAL(1, EventTimer_Expire(timers, 2, 1105U, &queue), "First period late by 5 ms");
+    TEST_ASSERT_EQUAL(0, EventTimer_Expire(timers, 2, 1199U, &queue), "Next expiry stays at 1200");
+    TEST_ASSERT_EQUAL(1, EventTimer_Expire(timers, 2, 1200U, &queue), "Second period on time");
+    TEST_ASSERT(EventTimer_Arm(timers, 2, EVENT_SWEEP_ARRIVED, 1200U, 10U, 0), "Second timer fits");
+    TEST_ASSERT(EventTimer_Arm(timers, 2, EVENT_SWEEP_ARRIVED, 1200U, 50U, 0), "Re-arm reuses the entry");
+    TEST_ASSERT(!EventTimer_Arm(timers, 2, EVENT_SCAN_ARRIVED, 1200U, 10U, 0), "Third timer should not fit");
+    EventTimer_Disarm(timers, 2, EVENT_CAPTURE_TIMEOUT);
+    TEST_ASSERT(EventTimer_Arm(timers, 2, EVENT_SCAN_ARRIVED, 1200U, 10U, 0), "Disarmed entry is free again");
+
+    /* Test 3: Tickless sleep length is the earliest deadline, wrap-safe */
+    memset(timers, 0, sizeof(timers));
+    TEST_ASSERT_EQUAL(EVENT_NO_TIMER, EventTimer_NextDue(timers, 2, 0), "No timer, no deadline");
+    EventTimer_Arm(timers, 2, EVENT_SCAN_ARRIVED, 0xFFFFFFF0U, 0x40U, 0);
+    EventTimer_Arm(timers, 2, EVENT_SWEEP_ARRIVED, 0xFFFFFFF0U, 0x20U, 0);
+    TEST_ASSERT_EQUAL(0x18, EventTimer_NextDue(timers, 2, 0xFFFFFFF8U), "Earliest timer across the wrap");
+    TEST_ASSERT_EQUAL(0, EventTimer_NextDue(timers, 2, 0x00000011U), "Overdue timer means no sleep");
+
+    /* Test 4: Ticks counted while SysTick was silent */
+    TEST_ASSERT_EQUAL(0, EventTimer_MissedTicks(400U, 399U), "Woken before the first boundary");
+    TEST_ASSERT_EQUAL(1, EventTimer_MissedTicks(400U, 400U), "First boundary reached");
+    TEST_ASSERT_EQUAL(1, EventTimer_MissedTicks(400U, 1399U), "Second boundary not yet reached");
+    TEST_ASSERT_EQUAL(10, EventTimer_MissedTicks(400U, 9400U), "Alarm on the tenth boundary");
+
+    return true;
+}
@@ -8,9 +8,18 @@
 
 #include "test_suite.h"
 #include "servo_driver.h"
+#include "servo_motion.h"
 #include "hcsr04.h"
+#include "telemetry.h"
+#include "packet.h"
+#include "ov2640.h"
+#include "timebase.h"
+#include "scan_pipeline.h"
+#include "scan_planner.h"
+#include "frame_pool.h"
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
 /* Private variables */
 static TestResult_t testResult;
@@ -66,6 +75,119 @@ bool Test_Servo_AngleToPulse(void)
     return true;
 }
 
+/**
+ * @brief  Test trapezoidal servo profile and arrival prediction
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_Motion_Profile(void)
+{
+    const float dt = MOTION_PERIOD_MS / 1000.0f;
+    Motion_Profile_t profile;
+    uint32_t steps;
+    float peak;
+
+    /* Test 1: No move, no wait */
+    profile = (Motion_Profile_t){ 90.0f, 0.0f, 90.0f, MOTION_MAX_SPEED_DPS };
+    TEST_ASSERT_EQUAL(0, Motion_MoveTime_ms(&profile), "Zero move should take no time");
+    TEST_ASSERT(!Motion_ProfileStep(&profile, dt), "Profile at rest should not move");
+
+    /* Test 2: 30 degree scan step lands exactly and beats the old 300 ms delay */
+    profile = (Motion_Profile_t){ 0.0f, 0.0f, 30.0f, MOTION_MAX_SPEED_DPS };
+    uint32_t eta = Motion_MoveTime_ms(&profile);
+    for (steps = 1; Motion_ProfileStep(&profile, dt); steps++) {
+        TEST_ASSERT(profile.position > 0.0f && profile.position < 30.0f, "Setpoint should stay between start and target");
+    }
+    TEST_ASSERT_FLOAT_EQUAL(30.0f, profile.position, 0.0001f, "Setpoint should land on the target");
+    TEST_ASSERT(eta >= (steps + 2U) * MOTION_PERIOD_MS + MOTION_SETTLE_MS, "ETA should not precede the setpoints run");
+    TEST_ASSERT(eta <= (steps + 4U) * MOTION_PERIOD_MS + MOTION_SETTLE_MS, "ETA should be at most 2 periods late");
+    TEST_ASSERT(eta < 300U, "30 degree step should be faster than the fixed delay");
+
+    /* Test 3: Full return sweep respects the speed limit and takes longer */
+    profile = (Motion_Profile_t){ 180.0f, 0.0f, 0.0f, MOTION_MAX_SPEED_DPS };
+    eta = Motion_MoveTime_ms(&profile);
+    peak = 0.0f;
+    while (Motion_ProfileStep(&profile, dt)) {
+        if (-profile.velocity > peak) {
+            peak = -profile.velocity;
+        }
+    }
+    TEST_ASSERT_FLOAT_EQUAL(0.0f, profile.position, 0.0001f, "Return sweep should land on 0");
+    TEST_ASSERT(peak <= MOTION_MAX_SPEED_DPS, "Speed should never exceed the cruise limit");
+    TEST_ASSERT(eta > 300U, "180 degree sweep should need more than 300 ms");
+
+    /* Test 4: Re-target while moving brakes and comes back without overshooting 0 */
+    profile = (Motion_Profile_t){ 90.0f, 0.0f, 180.0f, MOTION_MAX_SPEED_DPS };
+    for (uint32_t i = 0; i < 3U; i++) {
+        Motion_ProfileStep(&profile, dt);
+    }
+    TEST_ASSERT(profile.velocity > 0.0f, "Axis should be moving towards 180");
+    profile.target = 0.0f;
+    while (Motion_ProfileStep(&profile, dt)) {
+        TEST_ASSERT(profile.position > 0.0f, "Setpoint should not overshoot the new target");
+    }
+    TEST_ASSERT_FLOAT_EQUAL(0.0f, profile.position, 0.0001f, "Re-targeted move should land on 0");
+
+    return true;
+}
+
+/**
+ * @brief  Test constant-speed sweep and angle lookup on the trajectory
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_Motion_Sweep(void)
+{
+    const float dt = MOTION_PERIOD_MS / 1000.0f;
+    Motion_Profile_t profile;
+    uint32_t cruise = 0;
+    float angle;
+
+    /* Test 1: 30 deg/s sweep cruises at exactly that speed and lands on 180;
+     * the closed-form ETA covers all 300+ setpoints without running them */
+    profile = (Motion_Profile_t){ 0.0f, 0.0f, 180.0f, 30.0f };
+    uint32_t eta = Motion_MoveTime_ms(&profile);
+    uint32_t steps = 1;
+    while (Motion_ProfileStep(&profile, dt)) {
+        TEST_ASSERT(profile.velocity <= 30.0f, "Sweep should never exceed its speed");
+        if (profile.velocity == 30.0f) {
+            cruise++;
+        }
+        steps++;
+    }
+    TEST_ASSERT_FLOAT_EQUAL(180.0f, profile.position, 0.0001f, "Sweep should land on the end angle");
+    TEST_ASSERT(cruise > 290U, "Nearly all of a 6 s sweep should run at constant speed");
+    TEST_ASSERT(eta >= (steps + 2U) * MOTION_PERIOD_MS + MOTION_SETTLE_MS, "Sweep ETA should not be early");
+    TEST_ASSERT(eta <= (steps + 4U) * MOTION_PERIOD_MS + MOTION_SETTLE_MS, "Sweep ETA should be at most 2 periods late");
+
+    /* Test 2: Overshoot by float rounding lands instead of braking back */
+    profile = (Motion_Profile_t){ 132.53f, 0.0f, 113.33f, MOTION_MAX_SPEED_DPS };
+    while (Motion_ProfileStep(&profile, dt)) {
+        TEST_ASSERT(profile.position >= 113.33f - MOTION_LAND_DEG, "Setpoint should not pass the target");
+    }
+    TEST_ASSERT_FLOAT_EQUAL(113.33f, profile.position, 0.0001f, "Move should land on the target");
+
+    /* Test 3: Linear between setpoints, clamped after the last one */
+    const Motion_Point_t points[] = {
+        { 1000000U, 10.0f }, { 1020000U, 10.6f }, { 1040000U, 11.2f },
+    };
+    TEST_ASSERT(!Motion_Interpolate(points, 3, 999999U, &angle), "Time before the log should fail");
+    TEST_ASSERT(!Motion_Interpolate(points, 0, 1000000U, &angle), "Empty log should fail");
+    TEST_ASSERT(Motion_Interpolate(points, 3, 1000000U, &angle), "First point should be found");
+    TEST_ASSERT_FLOAT_EQUAL(10.0f, angle, 0.0001f, "First point angle");
+    TEST_ASSERT(Motion_Interpolate(points, 3, 1030000U, &angle), "Mid segment should be found");
+    TEST_ASSERT_FLOAT_EQUAL(10.9f, angle, 0.0001f, "Halfway between 10.6 and 11.2");
+    TEST_ASSERT(Motion_Interpolate(points, 3, 2000000U, &angle), "Time after the log should hold");
+    TEST_ASSERT_FLOAT_EQUAL(11.2f, angle, 0.0001f, "Axis rests on the last setpoint");
+
+    /* Test 4: Lookup across the 32-bit timebase wrap */
+    const Motion_Point_t wrapped[] = {
+        { 0xFFFFC000U, 90.0f }, { 0x00001000U, 91.0f },
+    };
+    TEST_ASSERT(Motion_Interpolate(wrapped, 2, 0xFFFFE800U, &angle), "Wrapped segment should be found");
+    TEST_ASSERT_FLOAT_EQUAL(90.5f, angle, 0.0001f, "Halfway across the wrap");
+
+    return true;
+}
+
 /**
  * @brief  Test ultrasonic pulse to distance conversion
  * @retval true if all tests pass, false otherwise
@@ -108,6 +230,512 @@ bool Test_HCSR04_PulseToDistance(void)
     return true;
 }
 
+/**
+ * @brief  Test extension of 16-bit captures onto the 32-bit timebase
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_Timebase_Extend(void)
+{
+    /* Test 1: Capture in the same 65.5 ms page as now */
+    TEST_ASSERT_EQUAL(0x00031234U, Timebase_Extend(0x00035000U, 0x1234U), "Same page keeps the high half");
+
+    /* Test 2: Capture equal to now */
+    TEST_ASSERT_EQUAL(0x0003BEEFU, Timebase_Extend(0x0003BEEFU, 0xBEEFU), "Capture at now is now");
+
+    /* Test 3: Low half wrapped between the capture and now */
+    TEST_ASSERT_EQUAL(0x0002FDE8U, Timebase_Extend(0x000301D0U, 0xFDE8U), "Capture before a page wrap");
+
+    /* Test 4: 32-bit clock wrapped between the capture and now */
+    TEST_ASSERT_EQUAL(0xFFFFFF00U, Timebase_Extend(0x00000100U, 0xFF00U), "Capture before a clock wrap");
+
+    /* Test 5: Echo width from rising and falling captures across a wrap */
+    uint32_t now = 0x00050300U;
+    uint32_t rise = Timebase_Extend(now, 65000U);
+    uint32_t fall = Timebase_Extend(now, 464U);
+    TEST_ASSERT_EQUAL(1000U, fall - rise, "Width should survive a counter wrap");
+    now = 0x00052000U;
+    TEST_ASSERT_EQUAL(5882U, Timebase_Extend(now, 6032U) - Timebase_Extend(now, 150U), "Width should be fall - rise");
+
+    return true;
+}
+
+/**
+ * @brief  Test HC-SR04 fixed-point, temperature-compensated conversion
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_HCSR04_FixedPoint(void)
+{
+    const uint32_t pulses[] = { 100, 1000, 2000, 5882, 11764, 23000 };
+    uint32_t factor;
+
+    /* Test 1: At 15 degC (340.3 m/s) the integer path matches the float
+     * reference (340 m/s) within 0.1% + 1 mm */
+    factor = HCSR04_SoundFactorQ16(150);
+    for (uint32_t i = 0; i < sizeof(pulses) / sizeof(pulses[0]); i++) {
+        float reference_mm = HCSR04_PulseToDistance(pulses[i]) * 10.0f;
+        float tolerance = reference_mm * 0.001f + 1.0f;
+        TEST_ASSERT_FLOAT_EQUAL(reference_mm, (float)HCSR04_PulseToMillimetres(pulses[i], factor),
+                                tolerance, "Fixed-point mm should match float reference");
+    }
+
+    /* Test 2: Table points and interpolation between them */
+    TEST_ASSERT_EQUAL(10856, HCSR04_SoundFactorQ16(0), "0 degC should be 331.3 m/s");
+    TEST_ASSERT_EQUAL(10906, HCSR04_SoundFactorQ16(25), "2.5 degC should interpolate");
+
+    /* Test 3: Out of range temperatures clamp to the table ends */
+    TEST_ASSERT_EQUAL(10030, HCSR04_SoundFactorQ16(-1000), "Below -40 degC should clamp");
+    TEST_ASSERT_EQUAL(12431, HCSR04_SoundFactorQ16(1000), "Above +85 degC should clamp");
+
+    /* Test 4: Same echo reads ~3.6% further at 20 degC than at 0 degC */
+    TEST_ASSERT_EQUAL(1656, HCSR04_PulseToMillimetres(10000, HCSR04_SoundFactorQ16(0)), "10ms echo at 0 degC");
+    TEST_ASSERT_EQUAL(1716, HCSR04_PulseToMillimetres(10000, HCSR04_SoundFactorQ16(200)), "10ms echo at 20 degC");
+
+    return true;
+}
+
+/**
+ * @brief  Test HC-SR04 median and EMA distance filter
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_HCSR04_Filter(void)
+{
+    HCSR04_Filter_t filter;
+    HCSR04_Sample_t echo = { 0, 1000, true, 172 };
+    HCSR04_Sample_t miss = { 0, 0, false, 0 };
+    const uint16_t odd[] = { 500, 100, 300 };
+    const uint16_t even[] = { 400, 200 };
+
+    /* Test 1: Median of odd and even counts */
+    TEST_ASSERT_EQUAL(300, HCSR04_Median(odd, 3), "Median of 3 should be the middle value");
+    TEST_ASSERT_EQUAL(300, HCSR04_Median(even, 2), "Median of 2 should be the mean");
+    TEST_ASSERT_EQUAL(500, HCSR04_Median(odd, 1), "Median of 1 should be the value");
+
+    /* Test 2: No estimate before the first echo */
+    HCSR04_FilterReset(&filter);
+    TEST_ASSERT(!HCSR04_FilterUpdate(&filter, &miss), "Timeout alone should give no estimate");
+
+    /* Test 3: Steady echoes give a steady estimate */
+    for (uint32_t i = 0; i < HCSR04_MEDIAN_LEN; i++) {
+        TEST_ASSERT(HCSR04_FilterUpdate(&filter, &echo), "Echo should give an estimate");
+    }
+    TEST_ASSERT_EQUAL(1000 << 4, filter.ema_q4, "Steady 1000us should filter to 1000us");
+
+    /* Test 4: A single bad echo does not move the estimate */
+    echo.echo_us = 9000;
+    HCSR04_FilterUpdate(&filter, &echo);
+    TEST_ASSERT_EQUAL(1000 << 4, filter.ema_q4, "Single outlier should be rejected by the median");
+
+    /* Test 5: Isolated timeouts keep the estimate, repeated ones drop it */
+    TEST_ASSERT(HCSR04_FilterUpdate(&filter, &miss), "One timeout should keep the estimate");
+    echo.echo_us = 1000;
+    HCSR04_FilterUpdate(&filter, &echo);
+    for (uint32_t i = 0; i < HCSR04_MAX_MISSES - 1U; i++) {
+        HCSR04_FilterUpdate(&filter, &miss);
+    }
+    TEST_ASSERT(filter.valid, "Timeouts below the limit should keep the estimate");
+    TEST_ASSERT(!HCSR04_FilterUpdate(&filter, &miss), "Too many timeouts should drop the estimate");
+
+    /* Test 6: A real step is followed once the median moves */
+    echo.echo_us = 1000;
+    HCSR04_FilterUpdate(&filter, &echo);
+    echo.echo_us = 2000;
+    for (int i = 0; i < 40; i++) {
+        HCSR04_FilterUpdate(&filter, &echo);
+    }
+    TEST_ASSERT_EQUAL(2000, (filter.ema_q4 + 8) >> 4, "Estimate should converge to the new distance");
+
+    return true;
+}
+
+/**
+ * @brief  Test HC-SR04 crosstalk-aware firing schedule
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_HCSR04_Schedule(void)
+{
+    uint8_t slots[HCSR04_MAX_SENSORS];
+
+    /* Test 1: One sensor needs one slot */
+    const uint8_t single[] = { 0x00 };
+    TEST_ASSERT_EQUAL(1, HCSR04_BuildSchedule(single, 1, slots), "One sensor should use one slot");
+    TEST_ASSERT_EQUAL(0x01, slots[0], "Slot 0 should hold sensor 0");
+
+    /* Test 2: Disjoint beams all fire together */
+    const uint8_t disjoint[] = { 0x00, 0x00, 0x00, 0x00 };
+    TEST_ASSERT_EQUAL(1, HCSR04_BuildSchedule(disjoint, 4, slots), "Disjoint sensors should share one slot");
+    TEST_ASSERT_EQUAL(0x0F, slots[0], "Slot 0 should hold all sensors");
+
+    /* Test 3: Neighbours in a ring (0-1-2-3-0) alternate, overlap listed one way only */
+    const uint8_t ring[] = { 0x02, 0x04, 0x08, 0x01 };
+    TEST_ASSERT_EQUAL(2, HCSR04_BuildSchedule(ring, 4, slots), "Ring of 4 should need two slots");
+    TEST_ASSERT_EQUAL(0x05, slots[0], "Slot 0 should hold sensors 0 and 2");
+    TEST_ASSERT_EQUAL(0x0A, slots[1], "Slot 1 should hold sensors 1 and 3");
+
+    /* Test 4: Fully overlapping beams fire one at a time */
+    const uint8_t all[] = { 0x0F, 0x0F, 0x0F };
+    TEST_ASSERT_EQUAL(3, HCSR04_BuildSchedule(all, 3, slots), "Overlapping sensors should get own slots");
+    TEST_ASSERT_EQUAL(0x04, slots[2], "Slot 2 should hold sensor 2");
+
+    return true;
+}
+
+/**
+ * @brief  Test HC-SR04 edge train to echo pulse extraction
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_HCSR04_Echoes(void)
+{
+    HCSR04_Echo_t echoes[HCSR04_MAX_ECHOES];
+
+    /* Test 1: One echo, start on the 32-bit clock */
+    const uint16_t single[] = { 1000, 6882 };
+    TEST_ASSERT_EQUAL(1, HCSR04_ExtractEchoes(single, 2, 0x00012000U, echoes), "Two edges should give one echo");
+    TEST_ASSERT_EQUAL(0x000103E8U, echoes[0].start_us, "Echo should start at the rising edge");
+    TEST_ASSERT_EQUAL(5882, echoes[0].width_us, "Echo width should be fall - rise");
+
+    /* Test 2: Glitch dropped, two echoes kept, unfinished echo ignored */
+    const uint16_t train[] = { 1000, 1040, 3000, 8882, 12000, 13000, 20000 };
+    TEST_ASSERT_EQUAL(2, HCSR04_ExtractEchoes(train, 7, 0x00015000U, echoes), "Train should give two echoes");
+    TEST_ASSERT_EQUAL(5882, echoes[0].width_us, "First echo should be the nearest reflector");
+    TEST_ASSERT_EQUAL(0x00012EE0U, echoes[1].start_us, "Second echo start");
+    TEST_ASSERT_EQUAL(1000, echoes[1].width_us, "Second echo width");
+
+    /* Test 3: Echo across a 16-bit counter wrap */
+    const uint16_t wrap[] = { 65000, 464 };
+    TEST_ASSERT_EQUAL(1, HCSR04_ExtractEchoes(wrap, 2, 0x00050300U, echoes), "Wrapped echo should be kept");
+    TEST_ASSERT_EQUAL(0x0004FDE8U, echoes[0].start_us, "Wrapped echo start");
+    TEST_ASSERT_EQUAL(1000, echoes[0].width_us, "Width should survive a counter wrap");
+
+    /* Test 4: A lone rising edge is no echo */
+    TEST_ASSERT_EQUAL(0, HCSR04_ExtractEchoes(single, 1, 0x00012000U, echoes), "One edge should give no echo");
+
+    return true;
+}
+
+/**
+ * @brief  Test packet CRC-16 and COBS encoding
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_Packet_Encoding(void)
+{
+    static const uint8_t check[] = "123456789";
+    uint8_t encoded[8];
+    uint8_t decoded[8];
+    size_t length;
+
+    /* Test 1: CRC-16/CCITT-FALSE check value */
+    TEST_ASSERT_EQUAL(0x29B1, Packet_Crc16(check, 9), "CRC of \"123456789\" should be 0x29B1");
+
+    /* Test 2: COBS of {0x00} is {0x01, 0x01} */
+    const uint8_t zero[] = {0x00};
+    length = Packet_CobsEncode(zero, sizeof(zero), encoded);
+    TEST_ASSERT_EQUAL(2, length, "COBS {00} length should be 2");
+    TEST_ASSERT(encoded[0] == 0x01 && encoded[1] == 0x01, "COBS {00} should encode to {01 01}");
+
+    /* Test 3: COBS of {0x11, 0x22, 0x00, 0x33} is {0x03, 0x11, 0x22, 0x02, 0x33} */
+    const uint8_t mixed[] = {0x11, 0x22, 0x00, 0x33};
+    length = Packet_CobsEncode(mixed, sizeof(mixed), encoded);
+    TEST_ASSERT_EQUAL(5, length, "COBS {11 22 00 33} length should be 5");
+    TEST_ASSERT(encoded[0] == 0x03 && encoded[3] == 0x02, "COBS code bytes should be 03 and 02");
+
+    /* Test 4: Decode restores the original bytes */
+    length = Packet_CobsDecode(encoded, length, decoded);
+    TEST_ASSERT_EQUAL(4, length, "COBS decode length should be 4");
+    TEST_ASSERT(decoded[0] == 0x11 && decoded[2] == 0x00 && decoded[3] == 0x33, "COBS decode should round-trip");
+
+    /* Test 5: Payload gathered in pieces encodes like one buffer */
+    uint8_t whole[PACKET_WIRE_SIZE(sizeof(mixed))];
+    uint8_t split[PACKET_WIRE_SIZE(sizeof(mixed))];
+    Packet_Encoder_t encoder;
+    size_t wholeLength = Packet_Encode(whole, PACKET_CHANNEL_IMAGE, mixed, sizeof(mixed));
+    Packet_Begin(&encoder, split, PACKET_CHANNEL_IMAGE, sizeof(mixed));
+    Packet_Append(&encoder, mixed, 2);
+    Packet_Append(&encoder, &mixed[2], 2);
+    TEST_ASSERT_EQUAL(wholeLength, Packet_End(&encoder), "Split packet length should match");
+    TEST_ASSERT(memcmp(whole, split, wholeLength) == 0, "Split packet bytes should match");
+
+    return true;
+}
+
+/**
+ * @brief  Test telemetry packet layout
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_Telemetry_Frame(void)
+{
+    Telemetry_Sample_t sample = {
+        .timestamp_ms = 0x00012345,
+        .pan_cdeg = 9000,
+        .tilt_cdeg = -500,
+        .distance_mm = 1234,
+        .flags = TELEMETRY_FLAG_RANGE_VALID
+    };
+    uint8_t frame[TELEMETRY_FRAME_MAX];
+    uint8_t record[TELEMETRY_FRAME_MAX];
+    size_t length;
+
+    length = Telemetry_EncodeFrame(&sample, 0x0102, frame);
+
+    /* Test 1: Frame is delimited and contains no other zero bytes */
+    TEST_ASSERT(length <= TELEMETRY_FRAME_MAX, "Frame should fit TELEMETRY_FRAME_MAX");
+    TEST_ASSERT(frame[0] == 0x00 && frame[length - 1] == 0x00, "Frame should be 0x00 delimited");
+    for (size_t i = 1; i < length - 1; i++) {
+        TEST_ASSERT(frame[i] != 0x00, "COBS body should not contain 0x00");
+    }
+
+    /* Test 2: Packet header carries channel and record length */
+    length = Packet_CobsDecode(&frame[1], length - 2, record);
+    TEST_ASSERT_EQUAL(TELEMETRY_RECORD_SIZE + PACKET_OVERHEAD, length, "Decoded packet should be header + record + CRC");
+    TEST_ASSERT_EQUAL(PACKET_CHANNEL_TELEMETRY, record[0], "Packet should be on the telemetry channel");
+    TEST_ASSERT_EQUAL(TELEMETRY_RECORD_SIZE, record[1] | (record[2] << 8), "Packet length should be the record size");
+
+    /* Test 3: Record carries version and fields, CRC covers the header */
+    const uint8_t *fields = &record[3];
+    TEST_ASSERT_EQUAL(TELEMETRY_VERSION, fields[0], "Record should start with version");
+    TEST_ASSERT_EQUAL(0x0102, fields[2] | (fields[3] << 8), "Sequence should be little-endian");
+    TEST_ASSERT_EQUAL(-500, (int16_t)(fields[10] | (fields[11] << 8)), "Tilt should be -500 cdeg");
+    TEST_ASSERT_EQUAL(1234, fields[12] | (fields[13] << 8), "Distance should be 1234 mm");
+
+    uint16_t crc = Packet_Crc16(record, length - 2);
+    TEST_ASSERT_EQUAL(crc, record[length - 2] | (record[length - 1] << 8), "CRC should match header and record");
+
+    return true;
+}
+
+/**
+ * @brief  Test OV2640 format switch register deltas
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_OV2640_FormatDelta(void)
+{
+    static OV2640_Shadow_t shadow;
+    static const OV2640_Reg_t qqvga[] = {
+        {0xFF, 0x01}, {0x12, 0x40}, {0x17, 0x11},
+        {0xFF, 0x00}, {0xE0, 0x04}, {0x5A, 0x28}, {0x5B, 0x1E}, {0xE0, 0x00},
+    };
+    static const OV2640_Reg_t qvga[] = {
+        {0xFF, 0x01}, {0x12, 0x40}, {0x17, 0x11},
+        {0xFF, 0x00}, {0xE0, 0x04}, {0x5A, 0x50}, {0x5B, 0x3C}, {0xE0, 0x00},
+    };
+    static const OV2640_Reg_t svga[] = {
+        {0xFF, 0x01}, {0x12, 0x00}, {0x17, 0x11},
+        {0xFF, 0x00}, {0xE0, 0x04}, {0x5A, 0x50}, {0x5B, 0x3C}, {0xE0, 0x00},
+    };
+    OV2640_Reg_t delta[OV2640_DELTA_MAX];
+    uint16_t count = 0;
+
+    /* Test 1: Unknown registers are all written */
+    OV2640_ShadowReset(&shadow);
+    TEST_ASSERT_EQUAL(OV2640_OK, OV2640_BuildDelta(&shadow, qqvga, 8, delta, OV2640_DELTA_MAX, &count), "Delta should fit");
+    TEST_ASSERT_EQUAL(8, count, "Unknown state should write the whole table");
+    for (uint16_t i = 0; i < count; i++) {
+        OV2640_ShadowWrite(&shadow, delta[i].reg, delta[i].val);
+    }
+
+    /* Test 2: Same format again needs no writes */
+    OV2640_BuildDelta(&shadow, qqvga, 8, delta, OV2640_DELTA_MAX, &count);
+    TEST_ASSERT_EQUAL(0, count, "Same format should need no writes");
+
+    /* Test 3: QQVGA -> QVGA only touches the DSP output size, wrapped in
+     * a DSP reset; the shadow is already on the DSP bank
+     */
+    OV2640_BuildDelta(&shadow, qvga, 8, delta, OV2640_DELTA_MAX, &count);
+    TEST_ASSERT_EQUAL(4, count, "QVGA delta should be 4 writes");
+    TEST_ASSERT(delta[0].reg == 0xE0 && delta[0].val == 0x04, "Delta should start with DSP reset");
+    TEST_ASSERT(delta[1].reg == 0x5A && delta[1].val == 0x50, "Delta should set ZMOW");
+    TEST_ASSERT(delta[2].reg == 0x5B && delta[2].val == 0x3C, "Delta should set ZMOH");
+    TEST_ASSERT(delta[3].reg == 0xE0 && delta[3].val == 0x00, "Delta should end DSP reset");
+
+    /* Test 4: COM7 change selects the sensor bank and rewrites the window,
+     * DSP registers are unchanged so the DSP reset is skipped
+     */
+    OV2640_ShadowWrite(&shadow, 0x5A, 0x50);
+    OV2640_ShadowWrite(&shadow, 0x5B, 0x3C);
+    OV2640_BuildDelta(&shadow, svga, 8, delta, OV2640_DELTA_MAX, &count);
+    TEST_ASSERT_EQUAL(3, count, "SVGA delta should be bank select, COM7, window");
+    TEST_ASSERT(delta[0].reg == 0xFF && delta[0].val == 0x01, "Delta should select sensor bank");
+    TEST_ASSERT(delta[1].reg == 0x12 && delta[1].val == 0x00, "Delta should write COM7");
+    TEST_ASSERT(delta[2].reg == 0x17, "Delta should rewrite registers after COM7");
+
+    /* Test 5: Too small a delta buffer is reported */
+    OV2640_ShadowReset(&shadow);
+    TEST_ASSERT_EQUAL(OV2640_ERROR, OV2640_BuildDelta(&shadow, qqvga, 8, delta, 4, &count), "Overflow should fail");
+
+    return true;
+}
+
+/**
+ * @brief  Test JPEG quality scale controller
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_OV2640_QualityScale(void)
+{
+    /* Test 1: Frame within 10% of the budget keeps the quality */
+    TEST_ASSERT_EQUAL(12, OV2640_NextQualityScale(12, 7000, 7000, false), "On budget should keep QS");
+    TEST_ASSERT_EQUAL(12, OV2640_NextQualityScale(12, 7600, 7000, false), "Within dead band should keep QS");
+
+    /* Test 2: Twice the budget moves halfway towards 2 * QS */
+    TEST_ASSERT_EQUAL(18, OV2640_NextQualityScale(12, 14000, 7000, false), "2x budget should raise QS to 18");
+
+    /* Test 3: Half the budget moves halfway towards QS / 2 */
+    TEST_ASSERT_EQUAL(9, OV2640_NextQualityScale(12, 3500, 7000, false), "Half budget should lower QS to 9");
+
+    /* Test 4: Small errors outside the dead band still move one step */
+    TEST_ASSERT_EQUAL(5, OV2640_NextQualityScale(4, 8000, 7000, false), "Slightly over should raise QS by 1");
+
+    /* Test 5: Truncated frame doubles QS */
+    TEST_ASSERT_EQUAL(24, OV2640_NextQualityScale(12, 10240, 7000, true), "Truncated frame should double QS");
+
+    /* Test 6: Result stays within the register range */
+    TEST_ASSERT_EQUAL(OV2640_QS_MAX, OV2640_NextQualityScale(40, 10240, 7000, true), "QS should clamp to max");
+    TEST_ASSERT_EQUAL(OV2640_QS_MIN, OV2640_NextQualityScale(3, 100, 7000, false), "QS should clamp to min");
+
+    /* Test 7: Budget from link speed: 115200 baud, 800 ms, 75% */
+    TEST_ASSERT_EQUAL(6912, OV2640_FrameBudget(115200, 800, 75), "Budget should be 6912 bytes");
+
+    return true;
+}
+
+/**
+ * @brief  Test scan pipeline stage sequencing
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_ScanPipeline(void)
+{
+    ScanPipeline_t pipe;
+    uint32_t actions;
+
+    /* Test 1: First step moves to the first stop, nothing else until arrival */
+    ScanPipeline_Reset(&pipe, true, true);
+    TEST_ASSERT_EQUAL(SCAN_ACT_MOVE, ScanPipeline_Step(&pipe, 0), "First step should start the move");
+    TEST_ASSERT_EQUAL(0, ScanPipeline_Step(&pipe, SCAN_EV_RANGE | SCAN_EV_BUFFER_FREE), "No stage should start while moving");
+
+    /* Test 2: Arrival starts ranging and capture together; a sample in the
+     * same batch was taken on the move */
+    actions = ScanPipeline_Step(&pipe, SCAN_EV_ARRIVED | SCAN_EV_RANGE | SCAN_EV_BUFFER_FREE);
+    TEST_ASSERT_EQUAL(SCAN_ACT_RANGE_START | SCAN_ACT_CAPTURE_START, actions, "Arrival should start range and capture");
+    TEST_ASSERT_EQUAL(0, pipe.rangeCount, "Sample from the move should not count");
+
+    /* Test 3: Stop completes only when both stages are done */
+    TEST_ASSERT_EQUAL(0, ScanPipeline_Step(&pipe, SCAN_EV_ARRIVED | SCAN_EV_RANGE), "One sample is not enough");
+    TEST_ASSERT_EQUAL(0, ScanPipeline_Step(&pipe, SCAN_EV_ARRIVED | SCAN_EV_RANGE), "Range done, capture still busy");
+    actions = ScanPipeline_Step(&pipe, SCAN_EV_ARRIVED | SCAN_EV_FRAME_DONE);
+    TEST_ASSERT_EQUAL(SCAN_ACT_REPORT | SCAN_ACT_MOVE, actions, "Measured stop should report and move on");
+
+    /* Test 4: Frame of the last stop goes out while the gimbal moves */
+    actions = ScanPipeline_Step(&pipe, SCAN_EV_FRAME_PENDING | SCAN_EV_RANGE);
+    TEST_ASSERT_EQUAL(SCAN_ACT_TX_START, actions, "Transfer should overlap the move");
+    TEST_ASSERT_EQUAL(0, ScanPipeline_Step(&pipe, SCAN_EV_FRAME_PENDING), "One transfer at a time");
+    TEST_ASSERT_EQUAL(SCAN_ACT_TX_START, ScanPipeline_Step(&pipe, SCAN_EV_TX_DONE | SCAN_EV_FRAME_PENDING),
+                      "Next frame should follow the completed transfer");
+
+    /* Test 5: No free buffer holds the gimbal at the stop */
+    actions = ScanPipeline_Step(&pipe, SCAN_EV_ARRIVED);
+    TEST_ASSERT_EQUAL(SCAN_ACT_RANGE_START, actions, "Capture should wait for a buffer");
+    ScanPipeline_Step(&pipe, SCAN_EV_RANGE);
+    TEST_ASSERT_EQUAL(0, ScanPipeline_Step(&pipe, SCAN_EV_RANGE), "Stop should not complete without a frame");
+    TEST_ASSERT_EQUAL(SCAN_ACT_CAPTURE_START, ScanPipeline_Step(&pipe, SCAN_EV_BUFFER_FREE), "Buffer freed, capture starts");
+
+    /* Test 6: Large format with the large buffer on the wire: the small
+     * free buffers don't raise SCAN_EV_BUFFER_FREE, the capture waits */
+    FramePool_Init();
+    Frame_t *large = FramePool_Acquire(FRAME_LARGE_BUFFER_SIZE);
+    FramePool_MarkReady(large, 1000U, 0);
+    FramePool_MarkTransmitting(large);
+    TEST_ASSERT_EQUAL(FRAME_POOL_SMALL_COUNT, FramePool_Count(FRAME_FREE), "Small buffers are free");
+    TEST_ASSERT(!FramePool_HasFree(FRAME_LARGE_BUFFER_SIZE), "No free buffer fits a large frame");
+    TEST_ASSERT(FramePool_HasFree(FRAME_BUFFER_SIZE), "A small frame would fit");
+
+    ScanPipeline_Reset(&pipe, true, false);
+    ScanPipeline_Step(&pipe, 0);
+    uint32_t events = SCAN_EV_ARRIVED;
+    if (FramePool_HasFree(FRAME_LARGE_BUFFER_SIZE)) {
+        events |= SCAN_EV_BUFFER_FREE;
+    }
+    TEST_ASSERT_EQUAL(0, ScanPipeline_Step(&pipe, events), "Capture should wait, not fail");
+    TEST_ASSERT_EQUAL(SCAN_STAGE_WAITING, pipe.capture, "Capture stage should be waiting");
+
+    FramePool_Release(large);
+    TEST_ASSERT(FramePool_HasFree(FRAME_LARGE_BUFFER_SIZE), "Large buffer is back");
+    TEST_ASSERT_EQUAL(SCAN_ACT_CAPTURE_START, ScanPipeline_Step(&pipe, SCAN_EV_BUFFER_FREE),
+                      "Capture starts once the large buffer is free");
+    FramePool_Init();
+
+    /* Test 7: Disabled stages are skipped */
+    ScanPipeline_Reset(&pipe, false, false);
+    ScanPipeline_Step(&pipe, 0);
+    actions = ScanPipeline_Step(&pipe, SCAN_EV_ARRIVED);
+    TEST_ASSERT_EQUAL(SCAN_ACT_REPORT | SCAN_ACT_MOVE, actions, "Stop without sensors completes on arrival");
+
+    return true;
+}
+
+/**
+ * @brief  Run a planned sweep against a scene with one edge
+ * @param  plan: Plan state, reset
+ * @param  edge: Angle of the edge (near object above, wall below)
+ * @param  stop_ms: Time charged per stop
+ * @param  last: Receives the last stop
+ * @retval Number of stops
+ */
+static uint8_t Test_ScanPlanSweep(ScanPlan_t *plan, float edge, uint32_t stop_ms, float *last)
+{
+    float angle = 0.0f;
+    uint8_t stops = 0;
+
+    while (ScanPlan_Next(plan, angle, stops * stop_ms, &angle) && stops < 100U) {
+        ScanPlan_Record(plan, angle, angle > edge ? 400U : 1000U, true);
+        stops++;
+        *last = angle;
+    }
+
+    return stops;
+}
+
+/**
+ * @brief  Test adaptive scan planner: coarse pass, edge bisection, budget
+ * @retval true if all tests pass, false otherwise
+ */
+bool Test_ScanPlan(void)
+{
+    static ScanPlan_t plan;
+    float angle = 0.0f;
+
+    /* Test 1: Flat wall keeps the coarse stops, 0 to 180 */
+    ScanPlan_Reset(&plan);
+    TEST_ASSERT_EQUAL(7, Test_ScanPlanSweep(&plan, 200.0f, 800U, &angle), "Flat wall: 7 coarse stops");
+    TEST_ASSERT_FLOAT_EQUAL(180.0f, angle, 0.01f, "Coarse pass should end at 180");
+
+    /* Test 2: Edge at 70 deg is bisected from 60-90 down to 1.875 deg:
+     * 75, 67.5, 71.25, 69.375 */
+    ScanPlan_Reset(&plan);
+    TEST_ASSERT_EQUAL(11, Test_ScanPlanSweep(&plan, 70.0f, 800U, &angle), "Edge: 7 coarse + 4 refining stops");
+    TEST_ASSERT_FLOAT_EQUAL(69.375f, angle, 0.001f, "Last stop should bracket the edge");
+    for (uint8_t i = 0; i + 1U < plan.count; i++) {
+        TEST_ASSERT(plan.points[i].angle < plan.points[i + 1U].angle, "Stops should be kept in angle order");
+    }
+
+    /* Test 3: Budget ends the refinement, never the coarse pass */
+    ScanPlan_Reset(&plan);
+    TEST_ASSERT_EQUAL(7, Test_ScanPlanSweep(&plan, 70.0f, SCAN_PLAN_BUDGET_MS / 7U, &angle), "Budget spent on the coarse pass");
+
+    /* Test 4: Coarse pass starts at the end nearer the gimbal */
+    ScanPlan_Reset(&plan);
+    TEST_ASSERT(ScanPlan_Next(&plan, 170.0f, 0, &angle), "First stop");
+    TEST_ASSERT_FLOAT_EQUAL(180.0f, angle, 0.01f, "Gimbal near 180: start there");
+
+    /* Test 5: Echo on one side only is an edge too */
+    ScanPlan_Reset(&plan);
+    for (uint8_t i = 0; i < 7U; i++) {
+        ScanPlan_Next(&plan, 0.0f, 0, &angle);
+        ScanPlan_Record(&plan, angle, 1000U, angle < 100.0f);
+    }
+    TEST_ASSERT(ScanPlan_Next(&plan, 180.0f, 1000U, &angle), "Range loss should be refined");
+    TEST_ASSERT_FLOAT_EQUAL(105.0f, angle, 0.01f, "Bisect the 90-120 gap");
+
+    return true;
+}
+
 /**
  * @brief  Run a single test and update results
  * @param  testFunc: Test function to run
@@ -148,7 +776,22 @@ void Run_All_Tests(void)
 
     /* Run all tests */
     Run_Single_Test(Test_Servo_AngleToPulse, "Servo Angle to Pulse Conversion");
+    Run_Single_Test(Test_Motion_Profile, "Servo Trapezoidal Motion Profile");
+    Run_Single_Test(Test_Motion_Sweep, "Servo Sweep and Angle Interpolation");
     Run_Single_Test(Test_HCSR04_PulseToDistance, "HC-SR04 Pulse to Distance Conversion");
+    Run_Single_Test(Test_HCSR04_FixedPoint, "HC-SR04 Fixed-Point Temperature Compensation");
+    Run_Single_Test(Test_HCSR04_Filter, "HC-SR04 Median and EMA Filter");
+    Run_Single_Test(Test_HCSR04_Schedule, "HC-SR04 Crosstalk-Aware Schedule");
+    Run_Single_Test(Test_HCSR04_Echoes, "HC-SR04 Multi-Echo Extraction");
+    Run_Single_Test(Test_Timebase_Extend, "Timebase 16-bit Capture Extension");
+    Run_Single_Test(Test_Packet_Encoding, "Packet CRC-16 and COBS Encoding");
+    Run_Single_Test(Test_Telemetry_Frame, "Telemetry Packet Layout");
+    Run_Single_Test(Test_OV2640_FormatDelta, "OV2640 Format Switch Register Delta");
+    Run_Single_Test(Test_OV2640_QualityScale, "OV2640 JPEG Quality Controller");
+    Run_Single_Test(Test_ScanPipeline, "Scan Pipeline Stage Sequencing");
+    Run_Single_Test(Test_ScanPlan, "Adaptive Scan Planner");
+    Run_Single_Test(Test_Ring, "SPSC Ring Buffer Stress");
+    Run_Single_Test(Test_EventLoop, "Event Queue and Software Timers");
 
     /* Print test summary */
     printf("========================================\r\n");
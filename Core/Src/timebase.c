@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+ * @file    timebase.c
+ * @brief   Shared 32-bit microsecond clock on TIM2
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    TIM2 configured as:
+ *          - Prescaler: 84-1 -> 1MHz, Period 0xFFFFFFFF (wraps after ~71 min)
+ *          - TRGO = enable with master/slave sync
+ *          TIM3 (echo capture, 16-bit, same prescaler) runs in slave trigger
+ *          mode on ITR1, so it starts on the same clock edge as TIM2 and its
+ *          counter always equals the low half of TIM2. A 16-bit capture can
+ *          then be placed on the 32-bit clock without overflow bookkeeping.
+ *
+ *          Every range sample, servo command and frame start is stamped from
+ *          this clock; differences are plain unsigned subtractions.
+ *
+ *          CH3 is a wake-up alarm for the tickless idle (event_loop.c); CH1
+ *          and CH2 belong to the HC-SR04 driver.
+ ******************************************************************************
+ */
+
+#include "timebase.h"
+#include "tim.h"
+
+/* Wake-up compare, output mode frozen (reset value of CCMR2) */
+#define TIMEBASE_ALARM_CHANNEL  TIM_CHANNEL_3
+
+/**
+ * @brief  Start the microsecond clock (and the 16-bit timers slaved to it)
+ * @param  None
+ * @retval None
+ * @note   Call once after MX_TIM2_Init() and MX_TIM3_Init().
+ */
+void Timebase_Init(void)
+{
+    HAL_TIM_Base_Start(&htim2);
+}
+
+/**
+ * @brief  Current time
+ * @param  None
+ * @retval Microseconds since Timebase_Init()
+ */
+uint32_t Timebase_Now(void)
+{
+    return __HAL_TIM_GET_COUNTER(&htim2);
+}
+
+/**
+ * @brief  Place a 16-bit capture from a slaved timer on the 32-bit clock
+ * @param  stamp16: Captured counter value
+ * @retval Capture time in microseconds
+ * @note   The capture must be less than 65.5 ms old.
+ */
+uint32_t Timebase_Extend16(uint32_t stamp16)
+{
+    return Timebase_Extend(Timebase_Now(), stamp16);
+}
+
+/**
+ * @brief  Raise the TIM2 interrupt at a given time
+ * @param  time_us: Alarm time, less than 2^31 us ahead
+ * @retval None
+ * @note   Used to end a WFI; the interrupt itself does nothing (the HAL
+ *         compare callback only reacts to CH1/CH2). Disarm with
+ *         Timebase_ClearAlarm() once awake.
+ */
+void Timebase_SetAlarm(uint32_t time_us)
+{
+    __HAL_TIM_SET_COMPARE(&htim2, TIMEBASE_ALARM_CHANNEL, time_us);
+    __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_CC3);
+    __HAL_TIM_ENABLE_IT(&htim2, TIM_IT_CC3);
+}
+
+/**
+ * @brief  Disarm the alarm
+ * @param  None
+ * @retval None
+ */
+void Timebase_ClearAlarm(void)
+{
+    __HAL_TIM_DISABLE_IT(&htim2, TIM_IT_CC3);
+    __HAL_TIM_CLEAR_FLAG(&htim2, TIM_FLAG_CC3);
+}
+
+/**
+ * @brief  Place a 16-bit stamp on a 32-bit clock (pure calculation for testing)
+ * @param  now: Current 32-bit time, read after the stamp was taken
+ * @param  stamp16: Low 16 bits of the time of the event
+ * @retval 32-bit time of the event, the latest one not after now
+ */
+uint32_t Timebase_Extend(uint32_t now, uint32_t stamp16)
+{
+    return now - (uint16_t)(now - stamp16);
+}
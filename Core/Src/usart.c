@@ -22,9 +22,11 @@
 
 /* USER CODE BEGIN 0 */
 #include <stdio.h>
+#include "serial_link.h"
 /* USER CODE END 0 */
 
 UART_HandleTypeDef huart1;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 /* USART1 init function */
 
@@ -80,6 +82,28 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
     GPIO_InitStruct.Alternate = GPIO_AF7_USART1;
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
+    /* USART1 DMA Init */
+    /* USART1_TX Init */
+    hdma_usart1_tx.Instance = DMA2_Stream7;
+    hdma_usart1_tx.Init.Channel = DMA_CHANNEL_4;
+    hdma_usart1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_usart1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_usart1_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_usart1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_usart1_tx.Init.Mode = DMA_NORMAL;
+    hdma_usart1_tx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_usart1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+
+    __HAL_LINKDMA(uartHandle,hdmatx,hdma_usart1_tx);
+
+    /* USART1 interrupt Init */
+    HAL_NVIC_SetPriority(USART1_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(USART1_IRQn);
   /* USER CODE BEGIN USART1_MspInit 1 */
 
   /* USER CODE END USART1_MspInit 1 */
@@ -103,6 +127,11 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* uartHandle)
     */
     HAL_GPIO_DeInit(GPIOA, GPIO_PIN_9|GPIO_PIN_10);
 
+    /* USART1 DMA DeInit */
+    HAL_DMA_DeInit(uartHandle->hdmatx);
+
+    /* USART1 interrupt Deinit */
+    HAL_NVIC_DisableIRQ(USART1_IRQn);
   /* USER CODE BEGIN USART1_MspDeInit 1 */
 
   /* USER CODE END USART1_MspDeInit 1 */
@@ -126,10 +155,30 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* uartHandle)
 
 PUTCHAR_PROTOTYPE
 {
-    HAL_UART_Transmit(&huart1, (uint8_t *)&ch, 1, HAL_MAX_DELAY);
+    uint8_t c = (uint8_t)ch;
+
+    /* Queued in the log ring buffer, drained by USART1 TX DMA */
+    SerialLink_Write(&c, 1);
     return ch;
 }
 
+/**
+ * @brief  Write a whole buffer from the C library in one go
+ * @note   Overrides the weak per-character _write() in syscalls.c, so a
+ *         printf costs one copy into the log ring instead of one blocking
+ *         UART transfer per character.
+ */
+#ifdef __GNUC__
+int _write(int file, char *ptr, int len)
+{
+    (void)file;
+    /* Report everything as written: with the DROP policy the C library
+     * would otherwise retry the rest forever */
+    SerialLink_Write((const uint8_t *)ptr, (uint32_t)len);
+    return len;
+}
+#endif /* __GNUC__ */
+
 /**
  * @brief  Retarget scanf to USART1 (optional)
  * @note   For GCC, scanf calls __io_getchar() (via syscalls.c).
@@ -144,7 +193,11 @@ PUTCHAR_PROTOTYPE
 GETCHAR_PROTOTYPE
 {
     uint8_t ch;
-    HAL_UART_Receive(&huart1, &ch, 1, HAL_MAX_DELAY);
+
+    /* Bytes arrive through the RXNE interrupt into the receive ring */
+    while (!SerialLink_ReadByte(&ch)) {
+        __WFI();
+    }
     return ch;
 }
 
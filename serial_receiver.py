@@ -4,6 +4,11 @@ STM32F407 Smart Gimbal - Serial Image Receiver
 Author: Auto-generated for sensor-design_v2_f407-1
 Description: Receives JPEG images and telemetry data from STM32 via UART
 
+Wire format: console text lines, with channel packets in between:
+    0x00 | COBS(channel | length LE16 | payload | CRC-16 LE) | 0x00
+    channel 0x01: telemetry record
+    channel 0x02: image chunk (frame id u16, offset u32, total u32, data)
+
 Usage:
     python3 serial_receiver.py /dev/ttyUSB0 115200
     python3 serial_receiver.py COM3 115200  # Windows
@@ -13,9 +18,93 @@ import serial
 import sys
 import os
 import time
+import struct
 from datetime import datetime
 
 
+# Packet channels (see Core/Inc/packet.h)
+CHANNEL_TELEMETRY = 0x01
+CHANNEL_IMAGE = 0x02
+
+# Image chunk header: frame id, offset, total length
+IMAGE_HEADER = struct.Struct('<HII')
+
+# Binary telemetry record (see Core/Src/telemetry.c):
+# version, flags, sequence, timestamp_ms, pan_cdeg, tilt_cdeg, distance_mm
+TELEMETRY_VERSION = 1
+TELEMETRY_RECORD = struct.Struct('<BBHIhhH')
+
+TELEMETRY_FLAGS = {
+    0x01: "RANGE_VALID",
+    0x02: "RANGE_TIMEOUT",
+    0x04: "IMAGE_CAPTURED",
+    0x08: "IMAGE_TRUNCATED",
+}
+
+
+def crc16_ccitt(data):
+    """CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Decode a COBS block (without delimiter), None if malformed"""
+    output = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        index += 1
+        if code == 0 or index + code - 1 > len(data):
+            return None
+        output += data[index:index + code - 1]
+        index += code - 1
+        if code != 0xFF and index < len(data):
+            output.append(0)
+    return bytes(output)
+
+
+def decode_packet(block):
+    """Decode one COBS block into (channel, payload), None if invalid"""
+    raw = cobs_decode(block)
+    if raw is None or len(raw) < 5:
+        return None
+
+    channel, length = raw[0], raw[1] | (raw[2] << 8)
+    if len(raw) != length + 5:
+        return None
+
+    crc = raw[-2] | (raw[-1] << 8)
+    if crc16_ccitt(raw[:-2]) != crc:
+        return None
+
+    return channel, raw[3:-2]
+
+
+def decode_telemetry(payload):
+    """Decode a telemetry record payload into a dict, None if invalid"""
+    if len(payload) != TELEMETRY_RECORD.size:
+        return None
+
+    version, flags, seq, timestamp, pan, tilt, distance = TELEMETRY_RECORD.unpack(payload)
+    if version != TELEMETRY_VERSION:
+        return None
+
+    return {
+        "seq": seq,
+        "timestamp_ms": timestamp,
+        "pan_deg": pan / 100.0,
+        "tilt_deg": tilt / 100.0,
+        "distance_cm": distance / 10.0,
+        "flags": [name for bit, name in TELEMETRY_FLAGS.items() if flags & bit],
+    }
+
+
 class STM32ImageReceiver:
     def __init__(self, port, baudrate=115200):
         """Initialize serial connection"""
@@ -24,6 +113,10 @@ class STM32ImageReceiver:
         self.ser = None
         self.image_count = 0
         self.output_dir = "captured_images"
+        self.image_id = None        # Frame id being reassembled
+        self.image_data = None
+        self.image_received = 0
+        self.bad_packets = 0
 
         # Create output directory
         if not os.path.exists(self.output_dir):
@@ -56,73 +149,12 @@ class STM32ImageReceiver:
         print("[INFO] Listening for data... (Press Ctrl+C to stop)\n")
 
         try:
-            image_data = bytearray()
-            receiving_image = False
-            text_buffer = ""
+            buffer = bytearray()
 
             while True:
                 if self.ser.in_waiting > 0:
-                    # Read raw bytes
-                    chunk = self.ser.read(self.ser.in_waiting)
-
-                    if receiving_image:
-                        # --- IMAGE MODE: Binary data collection ---
-
-                        # Check if IMG_END marker is in this chunk
-                        if b"IMG_END" in chunk:
-                            # Split: before IMG_END is image data, after is text
-                            parts = chunk.split(b"IMG_END", 1)
-                            image_data += parts[0]
-
-                            # Save the complete image
-                            self.save_image(image_data)
-
-                            # Extract size info from the rest of the line
-                            if len(parts) > 1:
-                                try:
-                                    end_line = parts[1].decode('utf-8', errors='ignore').split('\n')[0]
-                                    print(f"[IMAGE] IMG_END{end_line}")
-                                except:
-                                    print(f"[IMAGE] IMG_END received")
-
-                            # Reset state
-                            image_data = bytearray()
-                            receiving_image = False
-
-                            # Continue processing remaining text if any
-                            if len(parts) > 1 and len(parts[1]) > 0:
-                                text_buffer += parts[1].decode('utf-8', errors='ignore')
-                        else:
-                            # No end marker yet, accumulate all binary data
-                            image_data += chunk
-
-                    else:
-                        # --- TEXT MODE: Line-based processing ---
-
-                        # Decode as text
-                        text_buffer += chunk.decode('utf-8', errors='ignore')
-
-                        # Process complete lines
-                        while '\n' in text_buffer:
-                            line, text_buffer = text_buffer.split('\n', 1)
-                            line = line.strip()
-
-                            if not line:
-                                continue
-
-                            # Check for image start marker
-                            if "IMG_START" in line:
-                                print(f"\n[IMAGE] Receiving image #{self.image_count + 1}...")
-                                image_data = bytearray()
-                                receiving_image = True
-                                # Don't process more text, switch to binary mode
-                                text_buffer = ""
-                                break
-
-                            # Regular telemetry data
-                            else:
-                                timestamp = datetime.now().strftime("%H:%M:%S.%f")[:-3]
-                                print(f"[{timestamp}] {line}")
+                    buffer += self.ser.read(self.ser.in_waiting)
+                    self.process(buffer)
 
         except KeyboardInterrupt:
             print("\n\n[INFO] Stopped by user")
@@ -135,6 +167,89 @@ class STM32ImageReceiver:
                 self.ser.close()
                 print("[INFO] Serial port closed")
 
+    def process(self, buffer):
+        """Split the stream into text lines and 0x00-delimited packets"""
+        while True:
+            newline = buffer.find(b'\n')
+            delimiter = buffer.find(b'\x00')
+
+            if delimiter >= 0 and (newline < 0 or delimiter < newline):
+                end = buffer.find(b'\x00', delimiter + 1)
+                if end < 0:
+                    return  # Wait for the closing delimiter
+                packet = decode_packet(bytes(buffer[delimiter + 1:end]))
+                if packet is not None:
+                    # Cut the packet out, text around it joins up again
+                    del buffer[delimiter:end + 1]
+                    self.handle_packet(*packet)
+                else:
+                    # Out of sync (stray closing 0x00 or corrupted packet):
+                    # drop this delimiter, the next 0x00 may open a packet
+                    self.bad_packets += 1
+                    del buffer[delimiter]
+                continue
+
+            if newline < 0:
+                return
+
+            line = buffer[:newline].decode('utf-8', errors='ignore').strip()
+            del buffer[:newline + 1]
+
+            if line:
+                timestamp = datetime.now().strftime("%H:%M:%S.%f")[:-3]
+                print(f"[{timestamp}] {line}")
+
+    def handle_packet(self, channel, payload):
+        """Dispatch one packet by channel"""
+        if channel == CHANNEL_TELEMETRY:
+            self.handle_telemetry(payload)
+        elif channel == CHANNEL_IMAGE:
+            self.handle_image_chunk(payload)
+        else:
+            print(f"[WARN] Unknown channel 0x{channel:02X} ({len(payload)} bytes)")
+
+    def handle_telemetry(self, payload):
+        """Print one binary telemetry record"""
+        timestamp = datetime.now().strftime("%H:%M:%S.%f")[:-3]
+        record = decode_telemetry(payload)
+        if record is None:
+            print(f"[{timestamp}] [WARN] Bad telemetry record ({len(payload)} bytes)")
+            return
+
+        print(f"[{timestamp}] #{record['seq']} t={record['timestamp_ms']}ms "
+              f"Pan: {record['pan_deg']:.1f} deg | Tilt: {record['tilt_deg']:.1f} deg | "
+              f"Distance: {record['distance_cm']:.1f} cm [{' '.join(record['flags'])}]")
+
+    def handle_image_chunk(self, payload):
+        """Reassemble image chunks, save the frame once all bytes arrived"""
+        if len(payload) < IMAGE_HEADER.size:
+            return
+
+        frame_id, offset, total = IMAGE_HEADER.unpack_from(payload)
+        data = payload[IMAGE_HEADER.size:]
+
+        # Sequence numbers restart at 0 after a firmware reset, so a known id
+        # can belong to a new frame: also start over once the last frame was
+        # saved or when a chunk begins at offset 0
+        if frame_id != self.image_id or self.image_data is None or offset == 0:
+            if self.image_data is not None:
+                print(f"[WARN] Image #{self.image_id} incomplete "
+                      f"({self.image_received}/{len(self.image_data)} bytes), dropped")
+            print(f"\n[IMAGE] Receiving frame #{frame_id} ({total} bytes)...")
+            self.image_id = frame_id
+            self.image_data = bytearray(total)
+            self.image_received = 0
+
+        if offset + len(data) > len(self.image_data):
+            return
+
+        self.image_data[offset:offset + len(data)] = data
+        self.image_received += len(data)
+
+        if self.image_received >= len(self.image_data):
+            self.save_image(self.image_data)
+            self.image_data = None
+
     def save_image(self, data):
         """Save received image data to file"""
         # Verify JPEG header (0xFF 0xD8)
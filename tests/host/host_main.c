@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * @file    host_main.c
+ * @brief   Host runner for the unit tests of the HAL-free modules
+ * @author  Generated for STM32F407 Project
+ *
+ * @note    Runs the same test functions as the embedded suite
+ *          (Run_All_Tests) for the modules that build without HAL. The exit
+ *          code is the number of failed tests, for ctest.
+ ******************************************************************************
+ */
+
+#include "test_suite.h"
+#include <stdio.h>
+
+/* Private variables */
+static TestResult_t testResult;
+
+/**
+ * @brief  Report test failure on stdout
+ * @param  file: Source file name
+ * @param  line: Line number
+ * @param  message: Failure message
+ * @retval None
+ */
+void Test_ReportFailure(const char* file, uint32_t line, const char* message)
+{
+    printf("  [FAIL] %s:%lu - %s\n", file, (unsigned long)line, message);
+}
+
+/**
+ * @brief  Run a single test and update results
+ * @param  testFunc: Test function to run
+ * @param  testName: Name of the test
+ * @retval None
+ */
+static void Run_Single_Test(bool (*testFunc)(void), const char* testName)
+{
+    printf("Running: %s...\n", testName);
+
+    testResult.total++;
+
+    if (testFunc()) {
+        testResult.passed++;
+        printf("  [PASS] %s\n", testName);
+    } else {
+        testResult.failed++;
+    }
+}
+
+/**
+ * @brief  Run the host tests
+ * @retval Number of failed tests
+ */
+int main(void)
+{
+    Run_Single_Test(Test_Ring, "SPSC Ring Buffer Stress");
+    Run_Single_Test(Test_EventLoop, "Event Queue and Software Timers");
+
+    printf("\nTotal: %lu, Passed: %lu, Failed: %lu\n",
+           (unsigned long)testResult.total, (unsigned long)testResult.passed,
+           (unsigned long)testResult.failed);
+
+    return (int)testResult.failed;
+}